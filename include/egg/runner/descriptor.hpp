@@ -0,0 +1,60 @@
+/*!
+ *	\file		descriptor.hpp
+ *	\brief		Declares file descriptor utilities
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+#ifndef EGG_RUNNER_DESCRIPTOR
+#define EGG_RUNNER_DESCRIPTOR
+
+#include <sys/types.h>
+
+#include <vector>
+#include <system_error>
+
+#include <egg/common.hpp>
+
+
+namespace egg
+{
+
+struct EGG_PRIVATE descriptor
+{
+  // Close every descriptor from the_first up except the kept ones.
+  // Uses close_range(2) over the gaps between the kept descriptors,
+  // then the /proc/self/fd listing, then the getdtablesize() loop
+  static void
+  close_all(
+    const int               the_first,
+    std::vector<int>        the_keep);
+
+  // Process descriptor, -1 and errno set on failure
+  static int
+  pidfd_open(
+    const pid_t             the_pid) noexcept;
+
+  // Kernel supports process descriptors (checked once)
+  static bool
+  has_pidfd() noexcept;
+
+private:
+
+  EGG_PRIVATE static bool
+  __close_range(
+    const int               the_first,
+    const std::vector<int>& the_keep) noexcept;
+
+  EGG_PRIVATE static bool
+  __close_listed(
+    const int               the_first,
+    const std::vector<int>& the_keep);
+};
+
+} // End of egg namespace
+
+#endif  // EGG_RUNNER_DESCRIPTOR
+
+/* End of file */
@@ -10,12 +10,21 @@
 #ifndef EGG_RUNNER
 #define EGG_RUNNER
 
+#include <atomic>
+#include <chrono>
 #include <list>
+#include <map>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <egg/common.hpp>
 #include <egg/variable.hpp>
 #include <egg/runner/environment.hpp>
+#include <egg/runner/scanner.hpp>
 #include <egg/runner/signal.hpp>
+#include <egg/runner/spawner.hpp>
 
 
 namespace egg
@@ -39,7 +48,131 @@ public:
     working_directory,
     pid_file,
     syslog,
-    cgroup
+    cgroup,
+    scan_threads,
+    pid_lock,
+    instance_socket,
+    timing,
+    upgrade_signal,
+    workers,
+    supervisor,
+    readiness,
+    notify,
+    watchdog,
+    cpu_affinity,
+    numa_node,
+    cgroup_root,
+    cpu_max,
+    cpu_weight,
+    memory_high,
+    memory_max,
+    io_weight,
+    worker_cgroups,
+    scheduler,
+    sched_priority,
+    nice,
+    io_priority,
+    timer_slack,
+    memory_lock,
+    stack_prefault,
+    heap_reserve,
+    huge_pages,
+    huge_collapse,
+    memory_merge
+  };
+
+  /**********************************************
+   * Start-up phases
+   **********************************************/
+  enum class phase : std::uint32_t
+  {
+    initial,
+    before,
+    between,
+    after,
+    run,
+    complete
+  };
+
+  /**********************************************
+   * Start-up stages timed by execute()
+   **********************************************/
+  enum class stage : std::uint32_t
+  {
+    start,
+    service_check,
+    directory,
+    cgroup,
+    placement,
+    before,
+    limits,
+    scheduling,
+    worker_cgroups,
+    capabilities,
+    credentials,
+    working_directory,
+    first_fork,
+    session,
+    in_between,
+    between,
+    second_fork,
+    pid_file,
+    after,
+    count
+  };
+
+  /**********************************************
+   * Resource limits applied by execute()
+   **********************************************/
+  enum class limit : std::uint32_t
+  {
+    nofile,
+    memlock,
+    nproc,
+    core,
+    stack,
+    rtprio,
+    count
+  };
+
+  static constexpr std::uint64_t unlimited = ~std::uint64_t(0);
+
+  /**********************************************
+   * Respawn policy of the supervisor and of the workers (see
+   * property::supervisor and property::workers)
+   **********************************************/
+  struct supervision
+  {
+    // Backoff after the first crash, doubled per consecutive crash
+    std::chrono::milliseconds initial_delay = std::chrono::milliseconds(100);
+
+    // Backoff cap
+    std::chrono::milliseconds maximum_delay = std::chrono::seconds(30);
+
+    // A child alive longer than this resets the crash count
+    std::chrono::milliseconds window = std::chrono::seconds(60);
+
+    // Consecutive crashes to give up, 0 never gives up
+    unsigned crash_limit = 5;
+  };
+
+  /**********************************************
+   * Supervisor restart statistics
+   **********************************************/
+  struct restart_stat
+  {
+    // Respawns since the start
+    std::size_t restarts = 0;
+
+    // Consecutive abnormal exits
+    std::size_t crashes = 0;
+
+    // Child exit to the replacement fork, backoff included
+    std::chrono::nanoseconds last_latency = std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds max_latency = std::chrono::nanoseconds(0);
+
+    // Supervision gave up on the crash limit
+    bool is_crash_loop = false;
   };
 
   /**********************************************
@@ -69,7 +202,10 @@ public:
    **********************************************/
 
   /* Switch to background and run the sequence
-     before(), between(), after() and then run() */
+     before(), between(), after() and then run().
+     With property::readiness the launching parent returns once the
+     daemon is done with after(), rethrows the daemon failure as
+     std::system_error and reports the daemon timing */
   void execute();
 
 public:
@@ -85,12 +221,166 @@ public:
   void set(property, const egg::variable&);
   egg::variable get(property) const;
 
+  /**********************************************
+   * Descriptors kept over the terminal detach
+   **********************************************/
+  void keep(const int) noexcept;
+  void release(const int) noexcept;
+  const std::vector<int>& get_kept() const noexcept;
+
+  /**********************************************
+   * Resource limits. Applied after before() while the privileges are
+   * still held, so the hard limits can be raised too
+   **********************************************/
+
+  // Soft and hard limit, unlimited for RLIM_INFINITY
+  void set_limit(
+      const limit         /*the_limit*/,
+      const std::uint64_t /*the_soft*/,
+      const std::uint64_t /*the_hard*/) noexcept;
+
+  // Raise the soft limit to the hard one
+  void raise_limit(const limit) noexcept;
+
+  // Leave the inherited limit
+  void clear_limit(const limit) noexcept;
+
+  // Limit name
+  static const char* to_string(limit) noexcept;
+
+  /**********************************************
+   * Memory regions and their fork inheritance. The advice is applied
+   * at once and holds for every fork afterwards, the daemon forks
+   * included: register from before() only what the daemon drops.
+   * With property::numa_node the region moves to the preferred nodes,
+   * with property::huge_pages "advise" it is backed by huge pages and
+   * property::huge_collapse collapses it after after()
+   **********************************************/
+  struct region
+  {
+    void*                   address;
+    std::size_t             size;
+    spawner::inheritance    inheritance;
+  };
+
+  void add_region(
+      void*                       /*the_address*/,
+      const std::size_t           /*the_size*/,
+      const spawner::inheritance  /*the_inheritance*/ = spawner::inheritance::copy);
+
+  // Back to copy and forget the region
+  void remove_region(
+      void*                       /*the_address*/) noexcept;
+
+  const std::vector<region>& get_regions() const noexcept;
+
+  /**********************************************
+   * Service manager notifications (NOTIFY_SOCKET, see property::notify).
+   * READY=1 goes after after(), MAINPID= after the second fork and
+   * WATCHDOG=1 twice per WATCHDOG_USEC from a timer thread. With
+   * property::watchdog a keepalive is only sent if kick() was called
+   * since the previous one, so a hung run() lets the watchdog expire
+   **********************************************/
+
+  // Send the "KEY=VALUE" lines, false if not sent
+  bool notify(const std::string& /*the_state*/) noexcept;
+
+  // STATUS= line
+  bool set_status(const std::string& /*the_status*/) noexcept;
+
+  // Progress mark for the gated watchdog
+  void kick() noexcept;
+
+  // Keepalive interval requested by the manager, zero if none
+  std::chrono::microseconds get_watchdog_interval() const noexcept;
+
+  /**********************************************
+   * Socket activation (LISTEN_PID, LISTEN_FDS and LISTEN_FDNAMES)
+   **********************************************/
+
+  enum { listen_fds_start = 3 };
+
+  // First inherited descriptor with the name, -1 if none. Unnamed
+  // descriptors are called "unknown"
+  int get_listen_fd(const std::string& /*the_name*/) const noexcept;
+
+  // All inherited descriptors in the passed order
+  const std::vector<int>& get_listen_fds() const noexcept;
+
+  // Their names, same order
+  const std::vector<std::string>& get_listen_fd_names() const noexcept;
+
 public:
 
   // Get idea if this is the instance of successfuly initialized
   // background process
   bool is_final_instance() const noexcept;
 
+  // Current start-up phase
+  phase get_phase() const noexcept;
+
+  // Phase name
+  static const char* to_string(phase) noexcept;
+
+  // Monotonic time at the end of the stage, zero if not reached.
+  // Stamps taken before a fork are inherited by the child
+  std::chrono::nanoseconds get_timestamp(stage) const noexcept;
+
+  // Time spent in the stage, zero if not reached
+  std::chrono::nanoseconds get_duration(stage) const noexcept;
+
+  // Stage name
+  static const char* to_string(stage) noexcept;
+
+  /**********************************************
+   * Hot upgrade (see property::upgrade_signal)
+   **********************************************/
+
+  // The upgrade signal has been received since the start
+  bool is_upgrade_requested() const noexcept;
+
+  // This image resumed an instance handed over by upgrade()
+  bool is_resumed() const noexcept;
+
+  // Re-execute the binary in place handing over the listening sockets,
+  // the lock descriptors and the save_state() blob in a sealed memfd.
+  // The new image resumes in execute(): no service check, no forks,
+  // restore_state(), after() and run(). Returns by exception only
+  void upgrade();
+
+  /**********************************************
+   * Worker pool (see property::workers)
+   **********************************************/
+
+  // Worker index in [0, get_workers()), -1 in the master or without pool
+  int get_worker() const noexcept;
+
+  // Worker count, 0 means one per CPU of the affinity mask
+  std::size_t get_workers() const noexcept;
+
+  // Worker PIDs known to the master, -1 for the vacant slots
+  const std::vector<pid_t>& get_worker_pids() const noexcept;
+
+  /**********************************************
+   * Supervisor mode (see property::supervisor)
+   **********************************************/
+
+  // Respawn policy, applies to the next execute()
+  void set_supervision(const supervision&) noexcept;
+  const supervision& get_supervision() const noexcept;
+
+  // Restart statistics. A supervised child sees the figures of its
+  // supervisor as of its own fork
+  const restart_stat& get_restart_stat() const noexcept;
+
+  // Running under the supervisor
+  bool is_supervised() const noexcept;
+
+  // Ask a live instance bound to the abstract socket (see
+  // property::instance_socket) for its status: "pid=<pid> phase=<phase>"
+  static std::string query(
+      const std::string& /*the_label*/);
+
 protected:
 
   // What to do before the service switch to the background
@@ -105,6 +395,13 @@ protected:
   // Main cycle after the switch
   virtual void run() = 0;
 
+  // State handed over to the new image on upgrade()
+  virtual std::string save_state();
+
+  // Handed over state in the new image, called instead of before()
+  // and between()
+  virtual void restore_state(const std::string&);
+
 protected:
 
   // Environment
@@ -125,7 +422,27 @@ private:
   std::uint32_t			__f_req_syslog		: 1;
   std::uint32_t			__f_req_cgroup		: 1;
   std::uint32_t			__f_switch_complete	: 1;
-  std::uint32_t			__f_unused		: 23;
+  std::uint32_t			__f_req_pid_lock	: 1;
+  std::uint32_t			__f_req_instance	: 1;
+  std::uint32_t			__f_req_timing		: 1;
+  std::uint32_t			__f_req_upgrade		: 1;
+  std::uint32_t			__f_is_resumed		: 1;
+  std::uint32_t			__f_req_workers		: 1;
+  std::uint32_t			__f_req_supervisor	: 1;
+  std::uint32_t			__f_is_supervised	: 1;
+  std::uint32_t			__f_req_readiness	: 1;
+  std::uint32_t			__f_req_notify		: 1;
+  std::uint32_t			__f_req_watchdog	: 1;
+  std::uint32_t			__f_req_worker_cgroups	: 1;
+  std::uint32_t			__f_req_scheduler	: 1;
+  std::uint32_t			__f_req_nice		: 1;
+  std::uint32_t			__f_req_io_priority	: 1;
+  std::uint32_t			__f_req_timer_slack	: 1;
+  std::uint32_t			__f_req_memory_lock	: 1;
+  std::uint32_t			__f_req_huge_pages	: 1;
+  std::uint32_t			__f_req_huge_collapse	: 1;
+  std::uint32_t			__f_req_memory_merge	: 1;
+  std::uint32_t			__f_unused		: 3;
 
   // Program name
   std::string                   _name;
@@ -145,11 +462,233 @@ private:
   std::string			_working_directory;
   std::string			_pid_path;
 
+  // Locked PID file descriptor (property::pid_lock)
+  int				_pid_fd;
+
+  // Worker count for the /proc scan
+  unsigned			_scan_threads;
+
+  // /proc scanner of exists(): its buffers are allocated once, on the
+  // first call
+  std::unique_ptr<scanner>	_scanner;
+
+  // Start-up phase
+  std::atomic<std::uint32_t>	_phase;
+
+  // Start-up stage stamps, CLOCK_MONOTONIC nanoseconds
+  std::uint64_t			_timestamp[static_cast<std::size_t>(stage::count)];
+
+  // Abstract socket instance lock and status endpoint
+  std::string			_instance_label;
+  int				_instance_fd;
+  int				_instance_wake;
+  std::thread			_instance_thread;
+
+  // Descriptors preserved by __detach_terminal()
+  std::vector<int>		_keep;
+
+  // Socket activation
+  std::vector<int>		_listen_fds;
+  std::vector<std::string>	_listen_fd_names;
+  std::unordered_map<std::string, int> _listen_names;
+
+  // Hot upgrade
+  int				_upgrade_signal;
+  std::atomic<bool>		_upgrade_requested;
+
+  // Worker pool
+  std::size_t			_workers;
+  int				_worker;
+  std::vector<pid_t>		_worker_pids;
+  std::vector<int>		_worker_cpus;
+
+  // Supervisor mode
+  supervision			_supervision;
+  restart_stat			_restart_stat;
+
+  // Readiness pipe to the launching parent and its wait limit
+  int				_ready_fd[2];
+  std::chrono::milliseconds	_ready_timeout;
+
+  // Service manager socket and watchdog keepalives
+  int				_notify_fd;
+  std::chrono::microseconds	_watchdog_interval;
+  std::thread			_watchdog_thread;
+  int				_watchdog_wake;
+  std::atomic<std::uint64_t>	_watchdog_kicks;
+
+  // cgroup v2 subtree below the root and its control file values
+  std::string			_cgroup_root;
+  std::string			_cgroup_path;
+  std::map<std::string, std::string> _cgroup_limits;
+
+  // Resource limits
+  enum class limit_mode : std::uint32_t
+  {
+    none,
+    value,
+    raise
+  };
+
+  struct limit_entry
+  {
+    limit_mode      mode = limit_mode::none;
+    std::uint64_t   soft = 0;
+    std::uint64_t   hard = 0;
+  };
+
+  limit_entry			_limits[static_cast<std::size_t>(limit::count)];
+
+  // Scheduling applied with the limits
+  int				_sched_policy;
+  int				_sched_priority;
+  int				_nice;
+  int				_io_priority;
+  unsigned long			_timer_slack;
+
+  // Prefault sizes of property::memory_lock
+  std::size_t			_stack_prefault;
+  std::size_t			_heap_reserve;
+
+  // Transparent huge pages of property::huge_pages: "never" or "advise"
+  std::string			_huge_pages;
+
+  // Placement applied before before(): CPU and NUMA node lists
+  std::string			_cpu_affinity;
+  std::vector<unsigned>		_cpus;
+  std::string			_numa_node;
+  std::vector<unsigned>		_nodes;
+
+  // Regions registered with set_inheritance()
+  std::vector<region>		_regions;
+
 private:
 
+  // Timing
+  EGG_PRIVATE void __mark(stage)
+    noexcept;
+
+  EGG_PRIVATE void __report_timing()
+    noexcept;
+
   // Checkers
   EGG_PRIVATE void __is_service_up();
 
+  // 1 if the recorded process is alive, 0 if not, -1 if unknown
+  EGG_PRIVATE int __probe(
+      const pid_t         /*the_pid*/,
+      unsigned long long  /*the_start*/,
+      const std::string&  /*the_boot*/) noexcept;
+
+  // Start-up sequence, false in the parent processes
+  EGG_PRIVATE bool __launch();
+
+  // Socket activation
+  EGG_PRIVATE void __adopt_listen_fds();
+
+  // Hot upgrade
+  EGG_PRIVATE bool __resume();
+
+  EGG_PRIVATE void __arm_upgrade();
+
+  // Worker pool: the master supervises, the workers call run()
+  EGG_PRIVATE void __run_workers();
+
+  // Worker count and the CPUs of the affinity mask
+  EGG_PRIVATE std::size_t __count_workers();
+
+  // Worker side of the fork, never returns
+  EGG_PRIVATE void __run_worker(
+      const std::size_t /*the_index*/);
+
+  // Supervisor mode: true in the supervisor once supervision is over,
+  // false in the supervised child
+  EGG_PRIVATE bool __supervise();
+
+  // Respawn delay after the consecutive crashes, supervisor and workers
+  EGG_PRIVATE std::chrono::milliseconds __backoff(
+      const std::size_t /*the_crashes*/) const noexcept;
+
+  // Readiness handshake: the launching parent waits for the status
+  // record the daemon writes once after() is done or failed
+  EGG_PRIVATE void __open_ready();
+
+  EGG_PRIVATE void __await_ready();
+
+  EGG_PRIVATE void __notify_ready(
+      const int /*the_error*/) noexcept;
+
+  EGG_PRIVATE void __close_ready()
+    noexcept;
+
+  // Service manager notifications
+  EGG_PRIVATE void __open_notify();
+
+  EGG_PRIVATE void __start_watchdog();
+
+  EGG_PRIVATE void __stop_watchdog()
+    noexcept;
+
+  EGG_PRIVATE void __notify_error(
+      const int /*the_error*/) noexcept;
+
+  EGG_PRIVATE void __close_notify()
+    noexcept;
+
+  // Resource limits
+  EGG_PRIVATE void __set_limits();
+
+  // Scheduling policy, nice level, I/O priority and timer slack
+  EGG_PRIVATE void __set_scheduling();
+
+  EGG_PRIVATE void __set_scheduler(
+      const std::string& /*the_value*/);
+
+  EGG_PRIVATE void __set_sched_priority(
+      const std::string& /*the_value*/);
+
+  EGG_PRIVATE bool __is_realtime() const noexcept;
+
+  EGG_PRIVATE void __set_nice(
+      const std::string& /*the_value*/);
+
+  EGG_PRIVATE void __set_io_priority(
+      const std::string& /*the_value*/);
+
+  EGG_PRIVATE std::string __get_scheduler() const;
+
+  EGG_PRIVATE std::string __get_io_priority() const;
+
+  // cgroup v2: create or join the subtree, apply the limits and move
+  EGG_PRIVATE void __join_cgroup();
+
+  // Leaf cgroups of the workers, created and handed to the target
+  // user before the privileges are dropped (property::worker_cgroups)
+  EGG_PRIVATE void __make_worker_cgroups();
+
+  // Own leaf cgroup for the worker (property::worker_cgroups)
+  EGG_PRIVATE void __join_worker_cgroup(
+      const std::size_t /*the_index*/);
+
+  // mlockall() and prefault of the stack and the heap reserve
+  EGG_PRIVATE void __lock_memory();
+
+  // Huge pages, collapse and KSM of the registered regions
+  EGG_PRIVATE void __advise_memory();
+
+  // MADV_HUGEPAGE on the region with property::huge_pages "advise"
+  EGG_PRIVATE void __advise_region(
+      void*             /*the_address*/,
+      const std::size_t /*the_size*/) noexcept;
+
+  // CPU affinity and NUMA memory policy
+  EGG_PRIVATE void __set_placement();
+
+  // Move the region to the preferred nodes
+  EGG_PRIVATE void __place_region(
+      void*             /*the_address*/,
+      const std::size_t /*the_size*/) noexcept;
+
   // Capabilities
   EGG_PRIVATE void __set_capabilities()
     noexcept;
@@ -173,6 +712,23 @@ private:
   EGG_PRIVATE void __remove_pid()
     noexcept;
 
+  // Directory of the PID file, owned by the target user
+  EGG_PRIVATE void __make_pid_directory();
+
+  // Open and lock the PID file, false if it does not exist
+  EGG_PRIVATE bool __lock_pid(
+      const bool /*is_create_required*/);
+
+  // Instance socket
+  EGG_PRIVATE void __bind_instance();
+
+  EGG_PRIVATE void __serve_instance();
+
+  EGG_PRIVATE void __release_instance()
+    noexcept;
+
+  EGG_PRIVATE scanner& __get_scanner();
+
   EGG_PRIVATE const pid_t
   exists(
       const std::string /*name*/);
@@ -180,9 +736,116 @@ private:
   EGG_PRIVATE void
   exists(
       const std::string   /*name*/,
-      std::list<pid_t>&   /*result*/);
+      std::vector<pid_t>& /*result*/);
 };
 
+inline const std::vector<int>&
+process::get_kept() const noexcept
+{
+  return _keep;
+}
+
+inline void
+process::kick() noexcept
+{
+  _watchdog_kicks.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline std::chrono::microseconds
+process::get_watchdog_interval() const noexcept
+{
+  return _watchdog_interval;
+}
+
+inline const std::vector<process::region>&
+process::get_regions() const noexcept
+{
+  return _regions;
+}
+
+inline const std::vector<int>&
+process::get_listen_fds() const noexcept
+{
+  return _listen_fds;
+}
+
+inline const std::vector<std::string>&
+process::get_listen_fd_names() const noexcept
+{
+  return _listen_fd_names;
+}
+
+inline bool
+process::is_upgrade_requested() const noexcept
+{
+  return _upgrade_requested.load(std::memory_order_relaxed);
+}
+
+inline bool
+process::is_resumed() const noexcept
+{
+  return __f_is_resumed;
+}
+
+inline int
+process::get_worker() const noexcept
+{
+  return _worker;
+}
+
+inline std::size_t
+process::get_workers() const noexcept
+{
+  return _workers;
+}
+
+inline const std::vector<pid_t>&
+process::get_worker_pids() const noexcept
+{
+  return _worker_pids;
+}
+
+inline void
+process::set_supervision(
+    const supervision& the_supervision) noexcept
+{
+  _supervision = the_supervision;
+}
+
+inline const process::supervision&
+process::get_supervision() const noexcept
+{
+  return _supervision;
+}
+
+inline const process::restart_stat&
+process::get_restart_stat() const noexcept
+{
+  return _restart_stat;
+}
+
+inline bool
+process::is_supervised() const noexcept
+{
+  return __f_is_supervised;
+}
+
+inline std::chrono::nanoseconds
+process::get_timestamp(
+    stage the_stage) const noexcept
+{
+  return std::chrono::nanoseconds(
+    the_stage < stage::count
+      ? _timestamp[static_cast<std::size_t>(the_stage)]
+      : 0);
+}
+
+inline process::phase
+process::get_phase() const noexcept
+{
+  return static_cast<phase>(_phase.load(std::memory_order_relaxed));
+}
+
 inline void
 process::toggle(
     property p, bool the_value) noexcept
@@ -0,0 +1,198 @@
+/*!
+ *	\file		scanner.hpp
+ *	\brief		Declares /proc scanner
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+#ifndef EGG_RUNNER_SCANNER
+#define EGG_RUNNER_SCANNER
+
+#include <sys/types.h>
+
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <egg/common.hpp>
+
+
+namespace egg
+{
+
+/*
+ * Process table scanner
+ *
+ * Walks the /proc (or any directory of the same layout) with raw
+ * getdents64() into a buffer allocated once, skips non-numeric entries
+ * without parsing exceptions and reads <pid>/cmdline with openat()/pread()
+ * relative to the root descriptor. No allocation is done per entry.
+ *
+ * Only argv[0] is matched: the name is a substring of the first NUL
+ * terminated string in cmdline.
+ *
+ * The list search may run in parallel: the PIDs are collected first,
+ * then split into contiguous shards matched by a pool of worker threads
+ * and merged back in the directory order. Small tables are always
+ * matched serially.
+ *
+ * Example:
+ *
+ * egg::scanner s;
+ * pid_t pid = s.find("my-daemon", getpid());
+ */
+class EGG_PUBLIC scanner
+{
+
+public:
+
+  enum
+  {
+    directory_buffer_size = 64 * 1024,
+    cmdline_buffer_size   = 4 * 1024,
+    default_threshold     = 4096
+  };
+
+  /**********************************************
+   * Construct/destruct
+   **********************************************/
+  scanner(
+      const std::string& /*the_root*/ = "/proc");
+ ~scanner() noexcept;
+
+  // Lock copy
+  scanner(const scanner&) = delete;
+  scanner& operator=(const scanner&) = delete;
+
+  // Lock move
+  scanner(scanner&&) = delete;
+  scanner& operator=(scanner&&) = delete;
+
+public:
+
+  /**********************************************
+   * Scan
+   **********************************************/
+
+  // First process which argv[0] contains the name, -1 if none
+  pid_t find(
+      const std::string& /*the_name*/,
+      const pid_t        /*the_skip*/ = -1);
+
+  // All the processes which argv[0] contains the name
+  void find(
+      const std::string&  /*the_name*/,
+      std::vector<pid_t>& /*the_result*/,
+      const pid_t         /*the_skip*/ = -1);
+
+  /**********************************************
+   * Parallel mode
+   **********************************************/
+
+  // Worker count for the list search, 1 (default) is serial
+  void set_threads(const unsigned) noexcept;
+  unsigned get_threads() const noexcept;
+
+  // Minimal PID count to go parallel
+  void set_threshold(const std::size_t) noexcept;
+  std::size_t get_threshold() const noexcept;
+
+  /**********************************************
+   * Process stamps
+   **********************************************/
+
+  // Start time of the process in clock ticks after boot (field 22 of
+  // /proc/<pid>/stat), 0 if the process does not exist
+  static unsigned long long start_time(
+      const pid_t /*the_pid*/) noexcept;
+
+  // Kernel boot id, empty if not available
+  static std::string boot_id();
+
+  // Scanned root
+  const std::string& get_root() const noexcept;
+
+  // Root descriptor
+  int get_descriptor() const noexcept;
+
+private:
+
+  // Fill directory buffer, returns the count of bytes
+  EGG_PRIVATE long __read_directory();
+
+  // Collect all the PIDs into _candidates
+  EGG_PRIVATE void __collect(
+      const pid_t /*the_skip*/);
+
+  // Match cmdline of the pid against the name
+  EGG_PRIVATE bool __match(
+      const pid_t       /*the_pid*/,
+      const char*       /*the_name*/,
+      const std::size_t /*the_size*/,
+      char*             /*the_buffer*/) const noexcept;
+
+  // Parse decimal entry name, -1 if not a number
+  EGG_PRIVATE static pid_t __to_pid(
+      const char*) noexcept;
+
+private:
+
+  std::string               _root;
+  int                       _fd;
+
+  std::unique_ptr<char[]>   _directory_buffer;
+  std::unique_ptr<char[]>   _cmdline_buffer;
+
+  // Parallel mode
+  unsigned                  _threads;
+  std::size_t               _threshold;
+  std::vector<pid_t>        _candidates;
+};
+
+// Inlines
+inline void
+scanner::set_threads(
+    const unsigned the_threads) noexcept
+{
+  _threads = (the_threads ? the_threads : 1);
+}
+
+inline unsigned
+scanner::get_threads() const noexcept
+{
+  return _threads;
+}
+
+inline void
+scanner::set_threshold(
+    const std::size_t the_threshold) noexcept
+{
+  _threshold = the_threshold;
+}
+
+inline std::size_t
+scanner::get_threshold() const noexcept
+{
+  return _threshold;
+}
+
+inline const std::string&
+scanner::get_root() const noexcept
+{
+  return _root;
+}
+
+inline int
+scanner::get_descriptor() const noexcept
+{
+  return _fd;
+}
+
+} // End of egg namespace
+
+#endif  // EGG_RUNNER_SCANNER
+
+/* End of file */
@@ -10,9 +10,15 @@
 #ifndef EGG_SIGNAL
 #define EGG_SIGNAL
 
+#include <pthread.h>
 #include <signal.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <egg/common.hpp>
 
@@ -84,9 +90,13 @@ protected:
 
 inline handler::~handler() noexcept {}
 
-// Statistics
+// Statistics, a copy of the counters updated atomically by the delivery.
+// Histograms count durations in ns by powers of two: the bucket i holds
+// [2^i, 2^(i+1)) and the last one everything longer
 struct EGG_PUBLIC stat
 {
+  enum { histogram_size = 32 };
+
   stat() noexcept;
 
   stat(const stat&) noexcept;
@@ -99,6 +109,19 @@ struct EGG_PUBLIC stat
 
   unsigned long call_count;
   unsigned long error_count;
+
+  // Lost on the queue overflow
+  unsigned long overflow_count;
+
+  // Time spent in the handler
+  unsigned long handler_time[histogram_size];
+
+  // Queue mode only: from the signal context to the handler call. Empty
+  // in the descriptor and thread modes, a signalfd record has no time
+  unsigned long latency[histogram_size];
+
+  // CLOCK_MONOTONIC ns of the last handler call, 0 if none
+  std::uint64_t last_delivery;
 };
 
 /*
@@ -109,10 +132,57 @@ struct EGG_PUBLIC stat
  * Block/unblock signals using toggle
  *
  * Example: c.toggle();
+ *
+ * In descriptor mode the enabled signals stay blocked and are read from
+ * a signalfd, so the handlers run in the normal context of the thread
+ * calling dispatch(), with a null context. Poll get_descriptor() for
+ * POLLIN from an event loop or call dispatch(-1) from a thread of your
+ * own. The signals are blocked in the calling thread only: switch before
+ * any other thread is started.
+ *
+ * In queue mode the handlers are installed with sigaction, but the signal
+ * context only pushes siginfo with a timestamp to a lock-free ring of
+ * queue_size entries and wakes get_descriptor(); dispatch() drains the
+ * ring and calls the handlers. Signals lost on overflow are counted.
+ *
+ * start_dispatcher() runs dispatch(-1) on a thread of the controller in
+ * the deferred modes. Only one thread may dispatch at a time.
+ *
+ * Thread mode is the descriptor mode with the dispatcher started and
+ * stopped by set_mode(): all the signal cost lands on one thread. The
+ * masks are per thread (pthread_sigmask) and inherited at creation, so
+ * enable the handlers before starting the workers, or call
+ * block_thread() first thing in each worker. A thread not blocking a
+ * routed signal takes its default action instead. fork() stops the
+ * dispatcher and starts it again in both processes; the child gets
+ * descriptors of its own under the same numbers.
+ *
+ * Example: c.set_mode(signal::controller::mode::descriptor);
+ *          c.enable(new reload_handler());
+ *          while (c.dispatch(-1)) ...
  */
 union EGG_PUBLIC controller
 {
-  enum { count = NSIG };
+  enum
+  {
+    count      = NSIG,
+    queue_size = 1024
+  };
+
+  enum class mode
+  {
+    /// Handlers run in the signal context, installed with sigaction.
+    action,
+
+    /// Signals are blocked and read from a signalfd by dispatch().
+    descriptor,
+
+    /// Handlers installed with sigaction queue siginfo for dispatch().
+    queue,
+
+    /// Descriptor mode read by the dispatcher thread of the controller.
+    thread
+  };
 
   controller(const controller&) = delete;
   controller& operator=(const controller&) = delete;
@@ -122,7 +192,7 @@ union EGG_PUBLIC controller
 
   static controller& instance() noexcept;
 
-  // Signal manipulation
+  // Signal manipulation of the calling thread
   void lock();
   void lock(const int);
 
@@ -133,8 +203,45 @@ union EGG_PUBLIC controller
   void enable(handler::pointer);
   void disable(const int) noexcept;
 
+  // Delivery mode, the enabled handlers are moved over
+  void set_mode(mode);
+  mode get_mode() const noexcept;
+
+  // Signal descriptor in descriptor mode, queue event in queue mode,
+  // -1 otherwise
+  int get_descriptor() const noexcept;
+
+  // All the open descriptors of the controller, to keep them when the
+  // others are closed
+  std::vector<int> get_descriptors() const;
+
+  // True when the signal is read from the descriptor of the controller:
+  // another signalfd on it would race the controller for each delivery
+  bool is_routed(const int) const noexcept;
+
+  // Read the pending signals and call their handlers. Waits up to the
+  // timeout in ms (-1 forever) for the first one, returns the count
+  std::size_t dispatch(const int /*the_timeout*/ = 0);
+
+  // Dispatcher thread of the controller
+  void start_dispatcher();
+  void stop_dispatcher() noexcept;
+
+  // Block the signals with a handler in the calling thread, for the
+  // workers started before enable() or by foreign code
+  void block_thread() const;
+
+  // Start a thread with every signal blocked, for the runner threads:
+  // a routed signal never takes its default action there
+  template<typename Function>
+  static std::thread start_thread(Function&&);
+
   // Stat support
-  const stat& get_stat(const int) noexcept;
+  stat get_stat(const int) const noexcept;
+
+  // All the count entries at once: retried while calls, errors or
+  // overflows happen in between, up to a few times under a signal storm
+  std::vector<stat> snapshot() const;
 
 protected:
 
@@ -156,6 +263,31 @@ namespace egg
 namespace signal
 {
 
+template<typename Function>
+inline std::thread
+controller::start_thread(Function&& the_function)
+{
+  sigset_t __all;
+  sigset_t __saved;
+  sigfillset(&__all);
+  ::pthread_sigmask(SIG_BLOCK, &__all, &__saved);
+
+  std::thread __started;
+  try
+  {
+    __started = std::thread(std::forward<Function>(the_function));
+  }
+  catch (const std::system_error&)
+  {
+    ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+    throw;
+  }
+
+  ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+  return __started;
+}
+
 inline const int
 handler::id() const noexcept
 {
@@ -0,0 +1,72 @@
+/*!
+ *	\file		spawner.hpp
+ *	\brief		Declares fork with process descriptor and fork inheritance of memory
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+#ifndef EGG_RUNNER_SPAWNER
+#define EGG_RUNNER_SPAWNER
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+#include <egg/common.hpp>
+
+
+namespace egg
+{
+
+/*
+ * Process spawn utilities
+ *
+ * The fork cost of a large process is the page table copy, whatever
+ * the system call. Children are created by the C library fork(), so
+ * the pthread_atfork() handlers, the robust futex list and the cached
+ * thread ID stay right; the descriptor comes from pidfd_open() on the
+ * unreaped child.
+ *
+ * Large regions the children do not need are excluded from the copy
+ * with set_inheritance(): "none" leaves a hole in the child, "wipe"
+ * gives it zero filled pages. Both skip the page table copy.
+ *
+ * Example:
+ *
+ * int pidfd = -1;
+ * pid_t pid = egg::spawner::spawn(&pidfd);
+ */
+struct EGG_PUBLIC spawner
+{
+  enum class inheritance : std::uint32_t
+  {
+    copy,
+    none,
+    wipe
+  };
+
+  // fork() semantics: the child PID in the parent, 0 in the child.
+  // The child process descriptor goes to the_pidfd if set, -1 if not
+  // supported
+  static pid_t
+  spawn(
+    int*                    the_pidfd = nullptr);
+
+  // Inheritance of the page aligned mapping by the children
+  // created afterwards
+  static void
+  set_inheritance(
+    void*                   the_address,
+    const std::size_t       the_size,
+    const inheritance       the_inheritance);
+};
+
+} // End of egg namespace
+
+#endif  // EGG_RUNNER_SPAWNER
+
+/* End of file */
@@ -2,6 +2,7 @@
 
 INCLUDE ( CheckIncludeFile )
 INCLUDE ( CheckFunctionExists )
+INCLUDE ( CheckSymbolExists )
 
 IF (${CMAKE_SYSTEM_NAME} MATCHES "Linux")
 
@@ -156,6 +157,19 @@ IF (${CMAKE_SYSTEM_NAME} MATCHES "Linux")
   CHECK_FUNCTION_EXISTS ( clone		HAVE_CLONE	)
   CHECK_FUNCTION_EXISTS ( unshare	HAVE_UNSHARE	)
 
+  # Process descriptors
+  CHECK_SYMBOL_EXISTS ( SYS_pidfd_open	"sys/syscall.h"	HAVE_PIDFD_OPEN	)
+
+  # Memory placement
+  CHECK_SYMBOL_EXISTS ( SYS_set_mempolicy	"sys/syscall.h"	HAVE_SET_MEMPOLICY )
+
+  # Fork inheritance of memory
+  CHECK_SYMBOL_EXISTS ( MADV_WIPEONFORK	"sys/mman.h"	HAVE_MADV_WIPEONFORK )
+
+  # Descriptors
+  CHECK_SYMBOL_EXISTS ( SYS_close_range	"sys/syscall.h"	HAVE_CLOSE_RANGE )
+  CHECK_FUNCTION_EXISTS ( memfd_create	HAVE_MEMFD_CREATE )
+
   SET(__LINUX__ 1 CACHE INTERNAL "Platform macros")
 
 ELSE()
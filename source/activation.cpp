@@ -0,0 +1,127 @@
+/*!
+ *	\file		activation.cpp
+ *	\brief		Implements socket activation (LISTEN_FDS protocol)
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+
+#include <fcntl.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+int
+process::get_listen_fd(
+    const std::string& the_name) const noexcept
+{
+  const auto i = _listen_names.find(the_name);
+
+  return (i == _listen_names.end() ? -1 : i->second);
+}
+
+// Implementation
+void
+process::__adopt_listen_fds()
+{
+  const char* __pid   = ::getenv("LISTEN_PID");
+  const char* __count = ::getenv("LISTEN_FDS");
+
+  if (!__pid || !__count)
+    return;
+
+  // Passed to somebody else
+  if (std::strtol(__pid, nullptr, 10) != ::getpid())
+    return;
+
+  char* __end = nullptr;
+  const long __fds = std::strtol(__count, &__end, 10);
+
+  if (*__end != '\0' || __fds <= 0)
+    return;
+
+  // Split the names, missing ones are "unknown"
+  std::vector<std::string> __names;
+  if (const char* __list = ::getenv("LISTEN_FDNAMES"))
+  {
+    std::string __name;
+    for (const char* p = __list; ; ++p)
+    {
+      if (*p == ':' || *p == '\0')
+      {
+        __names.push_back(__name);
+        __name.clear();
+
+        if (*p == '\0')
+          break;
+      }
+      else
+        __name.push_back(*p);
+    }
+  }
+
+  _listen_fds.clear();
+  _listen_fd_names.clear();
+  _listen_names.clear();
+  _listen_fds.reserve(__fds);
+  _listen_fd_names.reserve(__fds);
+
+  for (long i = 0; i < __fds; ++i)
+  {
+    const int fd = listen_fds_start + i;
+
+    // Not inherited by anything we exec
+    const int __flags = ::fcntl(fd, F_GETFD);
+    if (__flags < 0)
+    {
+      std::error_code ec(errno, std::system_category());
+
+      std::string msg("Inherited descriptor ");
+      msg.append(std::to_string(fd));
+      msg.append(" is not open");
+
+      throw std::system_error(ec, msg);
+    }
+
+    ::fcntl(fd, F_SETFD, __flags | FD_CLOEXEC);
+
+    const std::string __name(
+          static_cast<std::size_t>(i) < __names.size() && !__names[i].empty()
+            ? __names[i]
+            : std::string("unknown"));
+
+    _listen_fds.push_back(fd);
+    _listen_fd_names.push_back(__name);
+    _listen_names.emplace(__name, fd);
+
+    keep(fd);
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Adopted descriptor %d as \"%s\"", fd, __name.c_str());
+    }
+  }
+
+  // Do not pass them further
+  ::unsetenv("LISTEN_PID");
+  ::unsetenv("LISTEN_FDS");
+  ::unsetenv("LISTEN_FDNAMES");
+}
+
+} // End of egg namespace
+
+/* End of file */
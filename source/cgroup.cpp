@@ -0,0 +1,286 @@
+/*!
+ *	\file		cgroup.cpp
+ *	\brief		Implements cgroup v2 placement and resource limits
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Write the control file at once. Missing files are created so that
+// a plain directory can stand in for the cgroupfs
+static void
+write_control(
+    const std::string& the_path,
+    const std::string& the_value)
+{
+  const int __fd = ::open(
+        the_path.c_str(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOCTTY,
+        S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  const bool __is_written = (__fd >= 0 &&
+      static_cast<ssize_t>(the_value.size()) ==
+        ::write(__fd, the_value.data(), the_value.size()));
+
+  std::error_code ec(errno, std::system_category());
+
+  if (__fd >= 0)
+    ::close(__fd);
+
+  if (!__is_written)
+  {
+    std::string msg("Failed to write \"");
+    msg.append(the_value);
+    msg.append("\" to ");
+    msg.append(the_path);
+
+    throw std::system_error(ec, msg);
+  }
+}
+
+// mkdir -p below the existing root
+static void
+make_path(
+    const std::string& the_root,
+    const std::string& the_path)
+{
+  std::string __path(the_root);
+
+  for (std::string::size_type __begin = 0; __begin < the_path.size();)
+  {
+    std::string::size_type __end = the_path.find('/', __begin);
+    if (std::string::npos == __end)
+      __end = the_path.size();
+
+    if (__end > __begin)
+    {
+      __path.push_back('/');
+      __path.append(the_path, __begin, __end - __begin);
+
+      if (::mkdir(__path.c_str(), S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) &&
+          EEXIST != errno)
+      {
+        std::error_code ec(errno, std::system_category());
+
+        std::string msg("Failed to create cgroup ");
+        msg.append(__path);
+
+        throw std::system_error(ec, msg);
+      }
+    }
+
+    __begin = __end + 1;
+  }
+}
+
+// Hand the file over to the user unless it is owned already. Missing
+// files are left to write_control() on a stand-in root
+static void
+delegate(
+    const std::string& the_path,
+    const uid_t        the_uid,
+    const gid_t        the_gid)
+{
+  struct stat __stat;
+
+  if (::stat(the_path.c_str(), &__stat))
+  {
+    if (ENOENT == errno)
+      return;
+  }
+  else if (__stat.st_uid == the_uid && __stat.st_gid == the_gid)
+  {
+    return;
+  }
+
+  if (::chown(the_path.c_str(), the_uid, the_gid))
+  {
+    std::error_code ec(errno, std::system_category());
+
+    std::string msg("Failed to delegate ");
+    msg.append(the_path);
+
+    throw std::system_error(ec, msg);
+  }
+}
+
+} // End of egg::helper namespace
+
+// Implementation
+void
+process::__join_cgroup()
+{
+  if (!__f_req_cgroup || _cgroup_path.empty())
+    return;
+
+  const std::string __target(_cgroup_root + "/" + _cgroup_path);
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "Joining cgroup %s ...", __target.c_str());
+  }
+
+  helper::make_path(_cgroup_root, _cgroup_path);
+
+  // Controllers of the limits enabled down the path, the target
+  // itself keeps no controllers for its children
+  std::string __controllers;
+  for (const auto& l : _cgroup_limits)
+  {
+    const std::string __name("+" + l.first.substr(0, l.first.find('.')));
+
+    if (std::string::npos == __controllers.find(__name))
+    {
+      if (!__controllers.empty())
+        __controllers.push_back(' ');
+
+      __controllers.append(__name);
+    }
+  }
+
+  if (!__controllers.empty())
+  {
+    std::string __parent(_cgroup_root);
+
+    for (std::string::size_type __begin = 0; __begin < _cgroup_path.size();)
+    {
+      try
+      {
+        helper::write_control(__parent + "/cgroup.subtree_control", __controllers);
+      }
+      catch (const std::system_error& e)
+      {
+        // Enabled by the delegating manager or not available at all,
+        // the limit write tells
+        if (__f_req_syslog && __f_trace)
+        {
+          ::syslog(LOG_DEBUG, "%s", e.what());
+        }
+      }
+
+      std::string::size_type __end = _cgroup_path.find('/', __begin);
+      if (std::string::npos == __end)
+        __end = _cgroup_path.size();
+
+      if (__end > __begin)
+      {
+        __parent.push_back('/');
+        __parent.append(_cgroup_path, __begin, __end - __begin);
+      }
+
+      __begin = __end + 1;
+    }
+  }
+
+  // Limits before the move: nothing is charged without them
+  for (const auto& l : _cgroup_limits)
+  {
+    helper::write_control(__target + "/" + l.first, l.second);
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set %s to \"%s\"", l.first.c_str(), l.second.c_str());
+    }
+  }
+
+  // Move, the forks follow
+  helper::write_control(__target + "/cgroup.procs", std::to_string(::getpid()));
+}
+
+void
+process::__make_worker_cgroups()
+{
+  if (!__f_req_cgroup ||
+      !__f_req_worker_cgroups ||
+      !__f_req_workers ||
+      _cgroup_path.empty())
+    return;
+
+  const std::string __target(_cgroup_root + "/" + _cgroup_path);
+  const std::size_t __count = __count_workers();
+
+  try
+  {
+    // Leaves without controllers: no internal process conflict with
+    // the master left in the parent
+    for (std::size_t i = 0; i < __count; ++i)
+    {
+      const std::string __name("worker-" + std::to_string(i));
+
+      helper::make_path(_cgroup_root, _cgroup_path + "/" + __name);
+
+      helper::delegate(__target + "/" + __name, _uid, _gid);
+      helper::delegate(__target + "/" + __name + "/cgroup.procs", _uid, _gid);
+    }
+
+    // A move needs write access to the common ancestor as well
+    helper::delegate(__target + "/cgroup.procs", _uid, _gid);
+  }
+  catch (const std::exception& e)
+  {
+    if (__f_req_syslog)
+    {
+      ::syslog(LOG_WARNING, "Worker cgroups: %s", e.what());
+    }
+
+    return;
+  }
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "Created %zu worker cgroups in %s", __count, __target.c_str());
+  }
+}
+
+void
+process::__join_worker_cgroup(
+    const std::size_t the_index)
+{
+  if (!__f_req_cgroup || !__f_req_worker_cgroups || _cgroup_path.empty())
+    return;
+
+  // Created by the master before the privileges were dropped
+  const std::string __name("worker-" + std::to_string(the_index));
+
+  try
+  {
+    helper::write_control(
+        _cgroup_root + "/" + _cgroup_path + "/" + __name + "/cgroup.procs",
+        std::to_string(::getpid()));
+  }
+  catch (const std::exception& e)
+  {
+    if (__f_req_syslog)
+    {
+      ::syslog(LOG_WARNING, "Worker %zu: %s", the_index, e.what());
+    }
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -0,0 +1,162 @@
+/*!
+ *	\file		descriptor.cpp
+ *	\brief		Implements file descriptor utilities
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+#include "common.h"
+
+#include <egg/runner/descriptor.hpp>
+
+
+namespace egg
+{
+
+void
+descriptor::close_all(
+    const int               the_first,
+    std::vector<int>        the_keep)
+{
+  // Sorted unique kept descriptors in range
+  the_keep.erase(
+        std::remove_if(
+          the_keep.begin(),
+          the_keep.end(),
+          [the_first](const int fd) { return fd < the_first; }),
+        the_keep.end());
+
+  std::sort(the_keep.begin(), the_keep.end());
+  the_keep.erase(std::unique(the_keep.begin(), the_keep.end()), the_keep.end());
+
+  if (__close_range(the_first, the_keep))
+    return;
+
+  if (__close_listed(the_first, the_keep))
+    return;
+
+  // Last resort
+  const int __count = ::getdtablesize();
+  std::vector<int>::const_iterator k = the_keep.begin();
+
+  for (int i = the_first; i < __count; ++i)
+  {
+    if (k != the_keep.end() && *k == i)
+    {
+      ++k;
+      continue;
+    }
+
+    ::close(i);
+  }
+}
+
+int
+descriptor::pidfd_open(
+    const pid_t the_pid) noexcept
+{
+#if HAVE_PIDFD_OPEN
+  return ::syscall(SYS_pidfd_open, the_pid, 0);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+bool
+descriptor::has_pidfd() noexcept
+{
+  static const bool __supported = []()
+  {
+    const int __fd = pidfd_open(::getpid());
+    if (__fd < 0)
+      return false;
+
+    ::close(__fd);
+    return true;
+  }();
+
+  return __supported;
+}
+
+// Implementation
+bool
+descriptor::__close_range(
+    const int               the_first,
+    const std::vector<int>& the_keep) noexcept
+{
+#if HAVE_CLOSE_RANGE
+
+  unsigned int __low = the_first;
+
+  for (const int k : the_keep)
+  {
+    if (static_cast<unsigned int>(k) > __low &&
+        ::syscall(SYS_close_range, __low, k - 1, 0) < 0)
+      return false;
+
+    __low = k + 1;
+  }
+
+  return (0 == ::syscall(SYS_close_range, __low, UINT_MAX, 0));
+
+#else
+
+  return false;
+
+#endif
+}
+
+bool
+descriptor::__close_listed(
+    const int               the_first,
+    const std::vector<int>& the_keep)
+{
+  DIR* __dir = ::opendir("/proc/self/fd");
+  if (!__dir)
+    return false;
+
+  // Collect first: closing while listing would shift the directory
+  const int __self = ::dirfd(__dir);
+  std::vector<int> __open;
+
+  for (struct dirent* entry  = ::readdir(__dir);
+                      entry != NULL;
+                      entry  = ::readdir(__dir))
+  {
+    if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+      continue;
+
+    const int fd = std::atoi(entry->d_name);
+
+    if (fd >= the_first &&
+        fd != __self &&
+        !std::binary_search(the_keep.begin(), the_keep.end(), fd))
+      __open.push_back(fd);
+  }
+
+  ::closedir(__dir);
+
+  for (const int fd : __open)
+    ::close(fd);
+
+  return true;
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -0,0 +1,410 @@
+/*!
+ *	\file		handover.cpp
+ *	\brief		Implements hot upgrade: in-place re-exec with state handover
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+extern char **environ;
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Handover descriptor variable
+static const char* const handover_variable = "EGG_HANDOVER_FD";
+
+// Handover record magic
+static const char* const handover_magic = "egg-handover 1";
+
+// Upgrade request: only raises the flag, upgrade() runs in normal context
+struct EGG_PRIVATE upgrade :
+    public egg::signal::handler
+{
+
+upgrade(
+    const int           the_id,
+    std::atomic<bool>&  the_flag) noexcept
+  :	egg::signal::handler(the_id, SA_RESTART),
+	_flag(the_flag)
+{
+}
+
+virtual ~upgrade() noexcept {}
+
+void process(int the_id) noexcept
+{
+  _flag.store(true, std::memory_order_relaxed);
+}
+
+void process(
+	int         the_id,
+	siginfo_t*  the_info,
+	void*       the_context) noexcept
+{
+  _flag.store(true, std::memory_order_relaxed);
+}
+
+std::atomic<bool>& _flag;
+
+};
+
+// Toggle close-on-exec
+static void
+inherit(
+    const int   the_fd,
+    const bool  is_inherited) noexcept
+{
+  const int __flags = ::fcntl(the_fd, F_GETFD);
+
+  if (__flags >= 0)
+  {
+    ::fcntl(
+        the_fd,
+        F_SETFD,
+        is_inherited ? (__flags & ~FD_CLOEXEC) : (__flags | FD_CLOEXEC));
+  }
+}
+
+// Current executable, the new file if it was replaced on disk
+static std::string
+executable()
+{
+  char __path[4096];
+  const ssize_t __count = ::readlink("/proc/self/exe", __path, sizeof(__path) - 1);
+
+  if (__count <= 0)
+    return std::string("/proc/self/exe");
+
+  std::string __result(__path, __count);
+
+  const std::string __deleted(" (deleted)");
+  if (__result.size() > __deleted.size() &&
+      0 == __result.compare(
+        __result.size() - __deleted.size(), __deleted.size(), __deleted))
+  {
+    __result.resize(__result.size() - __deleted.size());
+  }
+
+  return __result;
+}
+
+// Current arguments
+static std::vector<std::string>
+arguments()
+{
+  std::vector<std::string> __result;
+
+  const int __fd = ::open("/proc/self/cmdline", O_RDONLY | O_CLOEXEC);
+  if (__fd < 0)
+    return __result;
+
+  std::string __data;
+  char __buffer[4096];
+
+  for (ssize_t __count = ::read(__fd, __buffer, sizeof(__buffer));
+               __count > 0;
+               __count = ::read(__fd, __buffer, sizeof(__buffer)))
+  {
+    __data.append(__buffer, __count);
+  }
+
+  ::close(__fd);
+
+  for (std::string::size_type b = 0, e = 0; b < __data.size(); b = e + 1)
+  {
+    e = __data.find('\0', b);
+    if (std::string::npos == e)
+      e = __data.size();
+
+    __result.push_back(__data.substr(b, e - b));
+  }
+
+  return __result;
+}
+
+} // End of egg::helper namespace
+
+// Default state: nothing to hand over
+std::string
+process::save_state()
+{
+  return std::string();
+}
+
+void
+process::restore_state(
+    const std::string&)
+{
+}
+
+void
+process::upgrade()
+{
+#if HAVE_MEMFD_CREATE
+
+  if (__f_req_syslog)
+  {
+    ::syslog(LOG_NOTICE, "Upgrading process %d in place ...", ::getpid());
+  }
+
+  const std::string __state(save_state());
+
+  // Record: header lines, then the raw state
+  std::string __record(helper::handover_magic);
+  __record.push_back('\n');
+
+  // Passed order, duplicate names included. The name runs up to the
+  // end of the line: it may contain spaces, never a line break
+  for (std::size_t i = 0; i < _listen_fds.size(); ++i)
+  {
+    __record.append(
+        "listen " + std::to_string(_listen_fds[i]) + " " + _listen_fd_names[i] + "\n");
+  }
+
+  for (const int fd : _keep)
+  {
+    if (_listen_fds.end() == std::find(_listen_fds.begin(), _listen_fds.end(), fd))
+      __record.append("keep " + std::to_string(fd) + "\n");
+  }
+
+  if (_pid_fd >= 0)
+    __record.append("pid " + std::to_string(_pid_fd) + "\n");
+
+  if (_instance_fd >= 0)
+    __record.append("instance " + std::to_string(_instance_fd) + "\n");
+
+  __record.append("state " + std::to_string(__state.size()) + "\n");
+  __record.append(__state);
+
+  // Sealed memfd: the new image reads exactly what was written
+  const int __fd = ::memfd_create("egg-handover", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (__fd < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "memfd_create() failed");
+  }
+
+  if (static_cast<ssize_t>(__record.size()) !=
+        ::pwrite(__fd, __record.data(), __record.size(), 0) ||
+      ::fcntl(
+        __fd,
+        F_ADD_SEALS,
+        F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL))
+  {
+    std::error_code ec(errno, std::system_category());
+    ::close(__fd);
+
+    throw std::system_error(ec, "Handover record");
+  }
+
+  // Pass the descriptors over exec
+  std::vector<int> __passed(_keep);
+  __passed.push_back(_pid_fd);
+  __passed.push_back(_instance_fd);
+  __passed.push_back(__fd);
+
+  for (const int fd : __passed)
+  {
+    if (fd >= 0)
+      helper::inherit(fd, true);
+  }
+
+  ::setenv(helper::handover_variable, std::to_string(__fd).c_str(), 1);
+
+  // Same PID, new image
+  const std::string              __path(helper::executable());
+  const std::vector<std::string> __arguments(helper::arguments());
+
+  std::vector<char*> __argv;
+  for (const auto& a : __arguments)
+    __argv.push_back(const_cast<char*>(a.c_str()));
+  __argv.push_back(nullptr);
+
+  ::execve(__path.c_str(), __argv.data(), environ);
+
+  // Still here: roll back
+  std::error_code ec(errno, std::system_category());
+
+  ::unsetenv(helper::handover_variable);
+
+  for (const int fd : __passed)
+  {
+    if (fd >= 0)
+      helper::inherit(fd, false);
+  }
+
+  ::close(__fd);
+
+  _upgrade_requested = false;
+
+  std::string msg("execve(");
+  msg.append(__path);
+  msg.append(") failed");
+
+  if (__f_req_syslog)
+  {
+    ::syslog(LOG_ERR, "%s: %s, %d", msg.c_str(), ec.message().c_str(), ec.value());
+  }
+
+  throw std::system_error(ec, msg);
+
+#else
+
+  throw std::system_error(
+    std::make_error_code(std::errc::function_not_supported),
+    "memfd_create() not available");
+
+#endif
+}
+
+// Implementation
+bool
+process::__resume()
+{
+  const char* __variable = ::getenv(helper::handover_variable);
+  if (!__variable)
+    return false;
+
+  const int __fd = std::atoi(__variable);
+  ::unsetenv(helper::handover_variable);
+
+  // Only a sealed record is trusted
+  const int __seals = ::fcntl(__fd, F_GET_SEALS);
+  struct stat __stat;
+
+  if (__seals < 0 ||
+      !(__seals & F_SEAL_WRITE) ||
+      ::fstat(__fd, &__stat))
+  {
+    std::error_code ec(__seals < 0 || (__seals & F_SEAL_WRITE) ? errno : EPERM,
+                       std::system_category());
+    ::close(__fd);
+
+    throw std::system_error(ec, "Handover record is not sealed");
+  }
+
+  std::string __record(__stat.st_size, '\0');
+  const ssize_t __count = ::pread(__fd, &__record[0], __record.size(), 0);
+
+  ::close(__fd);
+
+  if (__count != static_cast<ssize_t>(__record.size()) ||
+      0 != __record.compare(0, std::strlen(helper::handover_magic), helper::handover_magic))
+  {
+    throw std::system_error(
+      std::make_error_code(std::errc::invalid_argument),
+      "Wrong handover record");
+  }
+
+  // Parse header lines up to the state
+  std::string __state;
+  std::string::size_type b = __record.find('\n') + 1;
+
+  while (b < __record.size())
+  {
+    const std::string::size_type e = __record.find('\n', b);
+    if (std::string::npos == e)
+      break;
+
+    const std::string __line(__record, b, e - b);
+    b = e + 1;
+
+    char __tag[16];
+    unsigned long long __value = 0;
+    int __end = 0;
+
+    if (std::sscanf(__line.c_str(), "%15s %llu%n", __tag, &__value, &__end) < 2)
+      continue;
+
+    // Rest of the line after one space
+    const std::string __name(
+        static_cast<std::size_t>(__end) < __line.size()
+          ? __line.substr(__end + 1)
+          : std::string());
+
+    const int fd = static_cast<int>(__value);
+
+    if (0 == std::strcmp(__tag, "state"))
+    {
+      __state.assign(__record, b, __value);
+      break;
+    }
+    else if (0 == std::strcmp(__tag, "listen"))
+    {
+      _listen_fds.push_back(fd);
+      _listen_fd_names.push_back(__name);
+      _listen_names.emplace(__name, fd);
+      keep(fd);
+    }
+    else if (0 == std::strcmp(__tag, "keep"))
+    {
+      keep(fd);
+    }
+    else if (0 == std::strcmp(__tag, "pid"))
+    {
+      _pid_fd = fd;
+    }
+    else if (0 == std::strcmp(__tag, "instance"))
+    {
+      _instance_fd = fd;
+    }
+    else
+      continue;
+
+    helper::inherit(fd, false);
+  }
+
+  __f_is_resumed = 1;
+
+  if (__f_req_syslog)
+  {
+    ::syslog(
+        LOG_NOTICE,
+        "Resuming process %d: %zu sockets, %zu bytes of state",
+        ::getpid(),
+        _listen_fds.size(),
+        __state.size());
+  }
+
+  restore_state(__state);
+
+  return true;
+}
+
+void
+process::__arm_upgrade()
+{
+  if (!__f_req_upgrade)
+    return;
+
+  _upgrade_requested = false;
+  _signal.enable(new helper::upgrade(_upgrade_signal, _upgrade_requested));
+}
+
+} // End of egg namespace
+
+/* End of file */
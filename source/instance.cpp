@@ -0,0 +1,287 @@
+/*!
+ *	\file		instance.cpp
+ *	\brief		Implements abstract socket instance lock and status endpoint
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Fill abstract address "\0<label>", returns the address length
+static socklen_t
+abstract_address(
+    const std::string&  the_label,
+    struct sockaddr_un& the_address)
+{
+  std::memset(&the_address, 0, sizeof(the_address));
+  the_address.sun_family = AF_UNIX;
+
+  if (the_label.empty() ||
+      the_label.size() > sizeof(the_address.sun_path) - 1)
+  {
+    std::string msg("Wrong instance socket label \"");
+    msg.append(the_label);
+    msg.append("\"");
+
+    throw std::system_error(
+      std::make_error_code(std::errc::invalid_argument), msg);
+  }
+
+  std::memcpy(the_address.sun_path + 1, the_label.data(), the_label.size());
+
+  return offsetof(struct sockaddr_un, sun_path) + 1 + the_label.size();
+}
+
+} // End of egg::helper namespace
+
+std::string
+process::query(
+    const std::string& the_label)
+{
+  struct sockaddr_un __address;
+  const socklen_t __length = helper::abstract_address(the_label, __address);
+
+  const int __fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (__fd < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "socket() failed");
+  }
+
+  struct timeval __timeout;
+  __timeout.tv_sec  = 1;
+  __timeout.tv_usec = 0;
+  ::setsockopt(__fd, SOL_SOCKET, SO_RCVTIMEO, &__timeout, sizeof(__timeout));
+
+  if (::connect(__fd, reinterpret_cast<struct sockaddr*>(&__address), __length) ||
+      0 > ::write(__fd, "status\n", sizeof("status\n") - 1))
+  {
+    std::error_code ec(errno, std::system_category());
+    ::close(__fd);
+
+    std::string msg("Instance \"@");
+    msg.append(the_label);
+    msg.append("\" query failed");
+
+    throw std::system_error(ec, msg);
+  }
+
+  // Read the reply up to EOF
+  std::string __result;
+  char __buffer[128];
+
+  for (ssize_t __count = ::read(__fd, __buffer, sizeof(__buffer));
+               __count > 0;
+               __count = ::read(__fd, __buffer, sizeof(__buffer)))
+  {
+    __result.append(__buffer, __count);
+  }
+
+  ::close(__fd);
+
+  while (!__result.empty() && '\n' == __result.back())
+    __result.pop_back();
+
+  return __result;
+}
+
+// Implementation
+void
+process::__bind_instance()
+{
+  if (_instance_fd >= 0)
+    return;
+
+  struct sockaddr_un __address;
+  const socklen_t __length = helper::abstract_address(_instance_label, __address);
+
+  const int __fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (__fd < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "socket() failed");
+  }
+
+  if (::bind(__fd, reinterpret_cast<struct sockaddr*>(&__address), __length))
+  {
+    std::error_code ec(errno, std::system_category());
+    ::close(__fd);
+
+    if (EADDRINUSE == ec.value())
+    {
+      std::string msg("Instance \"@");
+      msg.append(_instance_label);
+      msg.append("\" is bound. Please, stop it first");
+
+      if (__f_req_syslog)
+      {
+        ::syslog(LOG_ALERT, "%s", msg.c_str());
+      }
+
+      throw std::system_error(
+        std::make_error_code(std::errc::device_or_resource_busy), msg);
+    }
+
+    throw std::system_error(ec, "Instance socket bind() failed");
+  }
+
+  if (::listen(__fd, 8))
+  {
+    std::error_code ec(errno, std::system_category());
+    ::close(__fd);
+
+    throw std::system_error(ec, "Instance socket listen() failed");
+  }
+
+  _instance_fd = __fd;
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_DEBUG, "Instance socket \"@%s\" bound", _instance_label.c_str());
+  }
+}
+
+void
+process::__serve_instance()
+{
+  if (_instance_fd < 0 || _instance_thread.joinable())
+    return;
+
+  // Stop event: the listening socket may be shared with forked
+  // processes, so it is never shut down to wake the thread
+  _instance_wake = ::eventfd(0, EFD_CLOEXEC);
+  if (_instance_wake < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "eventfd() failed");
+  }
+
+  _instance_thread = signal::controller::start_thread([this]()
+  {
+    struct pollfd __poll[2];
+    __poll[0].fd     = _instance_fd;
+    __poll[0].events = POLLIN;
+    __poll[1].fd     = _instance_wake;
+    __poll[1].events = POLLIN;
+
+    for (;;)
+    {
+      __poll[0].revents = __poll[1].revents = 0;
+
+      if (::poll(__poll, 2, -1) < 0)
+      {
+        if (EINTR == errno)
+          continue;
+
+        break;
+      }
+
+      // Stop requested
+      if (__poll[1].revents)
+        break;
+
+      const int __fd = ::accept4(
+            _instance_fd,
+            nullptr,
+            nullptr,
+            SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+      // Taken by another process sharing the socket
+      if (__fd < 0)
+        continue;
+
+      // Slow clients do not hold the endpoint
+      const int __flags = ::fcntl(__fd, F_GETFL);
+      ::fcntl(__fd, F_SETFL, __flags & ~O_NONBLOCK);
+
+      struct timeval __timeout;
+      __timeout.tv_sec  = 1;
+      __timeout.tv_usec = 0;
+      ::setsockopt(__fd, SOL_SOCKET, SO_RCVTIMEO, &__timeout, sizeof(__timeout));
+
+      char __request[64];
+      const ssize_t __count = ::read(__fd, __request, sizeof(__request));
+
+      char __reply[128];
+      int __size = 0;
+
+      if (__count >= 6 && 0 == std::memcmp(__request, "status", 6))
+      {
+        __size = std::snprintf(
+              __reply,
+              sizeof(__reply),
+              "pid=%d phase=%s\n",
+              ::getpid(),
+              to_string(get_phase()));
+      }
+      else
+      {
+        __size = std::snprintf(__reply, sizeof(__reply), "error=unknown\n");
+      }
+
+      if (0 > ::send(__fd, __reply, __size, MSG_NOSIGNAL))
+      {
+        // Client gone
+      }
+
+      ::close(__fd);
+    }
+  });
+}
+
+void
+process::__release_instance() noexcept
+{
+  // Wake up the endpoint thread and wait for it
+  if (_instance_thread.joinable())
+  {
+    const std::uint64_t __one = 1;
+    if (0 > ::write(_instance_wake, &__one, sizeof(__one)))
+    {
+      // Counter overflow only
+    }
+
+    _instance_thread.join();
+  }
+
+  if (_instance_wake >= 0)
+  {
+    ::close(_instance_wake);
+    _instance_wake = -1;
+  }
+
+  if (_instance_fd >= 0)
+  {
+    ::close(_instance_fd);
+    _instance_fd = -1;
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -0,0 +1,170 @@
+/*!
+ *	\file		limits.cpp
+ *	\brief		Implements resource limits applied by execute()
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/resource.h>
+
+#include <syslog.h>
+
+#include <cerrno>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+static int
+to_resource(
+    const process::limit the_limit) noexcept
+{
+  switch (the_limit)
+  {
+    case process::limit::nofile:  return RLIMIT_NOFILE;
+    case process::limit::memlock: return RLIMIT_MEMLOCK;
+    case process::limit::nproc:   return RLIMIT_NPROC;
+    case process::limit::core:    return RLIMIT_CORE;
+    case process::limit::stack:   return RLIMIT_STACK;
+    case process::limit::rtprio:  return RLIMIT_RTPRIO;
+    default:                      break;
+  }
+
+  return -1;
+}
+
+static rlim_t
+to_rlim(
+    const std::uint64_t the_value) noexcept
+{
+  return (process::unlimited == the_value ? RLIM_INFINITY : static_cast<rlim_t>(the_value));
+}
+
+} // End of egg::helper namespace
+
+constexpr std::uint64_t process::unlimited;
+
+void
+process::set_limit(
+    const limit         the_limit,
+    const std::uint64_t the_soft,
+    const std::uint64_t the_hard) noexcept
+{
+  if (the_limit >= limit::count)
+    return;
+
+  auto& __entry = _limits[static_cast<std::size_t>(the_limit)];
+
+  __entry.mode = limit_mode::value;
+  __entry.soft = the_soft;
+  __entry.hard = the_hard;
+}
+
+void
+process::raise_limit(
+    const limit the_limit) noexcept
+{
+  if (the_limit >= limit::count)
+    return;
+
+  _limits[static_cast<std::size_t>(the_limit)].mode = limit_mode::raise;
+}
+
+void
+process::clear_limit(
+    const limit the_limit) noexcept
+{
+  if (the_limit >= limit::count)
+    return;
+
+  _limits[static_cast<std::size_t>(the_limit)].mode = limit_mode::none;
+}
+
+const char*
+process::to_string(
+    const limit the_limit) noexcept
+{
+  switch (the_limit)
+  {
+    case limit::nofile:  return "nofile";
+    case limit::memlock: return "memlock";
+    case limit::nproc:   return "nproc";
+    case limit::core:    return "core";
+    case limit::stack:   return "stack";
+    case limit::rtprio:  return "rtprio";
+    default:             break;
+  }
+
+  return "unknown";
+}
+
+// Implementation
+void
+process::__set_limits()
+{
+  for (std::size_t i = 0; i < static_cast<std::size_t>(limit::count); ++i)
+  {
+    const auto& __entry = _limits[i];
+
+    if (limit_mode::none == __entry.mode)
+      continue;
+
+    const limit __limit    = static_cast<limit>(i);
+    const int   __resource = helper::to_resource(__limit);
+
+    struct rlimit __value;
+
+    if (limit_mode::raise == __entry.mode)
+    {
+      if (::getrlimit(__resource, &__value))
+      {
+        throw std::system_error(errno, std::system_category(), "getrlimit() failed");
+      }
+
+      __value.rlim_cur = __value.rlim_max;
+    }
+    else
+    {
+      __value.rlim_cur = helper::to_rlim(__entry.soft);
+      __value.rlim_max = helper::to_rlim(__entry.hard);
+    }
+
+    // Raising the hard limit takes CAP_SYS_RESOURCE, still held here
+    if (::setrlimit(__resource, &__value))
+    {
+      std::error_code ec(errno, std::system_category());
+
+      std::string msg("Failed to set ");
+      msg.append(to_string(__limit));
+      msg.append(" limit");
+
+      throw std::system_error(ec, msg);
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(
+          LOG_DEBUG,
+          "Set %s limit to %llu/%llu",
+          to_string(__limit),
+          static_cast<unsigned long long>(__value.rlim_cur),
+          static_cast<unsigned long long>(__value.rlim_max));
+    }
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
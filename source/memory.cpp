@@ -0,0 +1,232 @@
+/*!
+ *	\file		memory.cpp
+ *	\brief		Implements memory locking, prefault and page advice
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+#include <alloca.h>
+#include <malloc.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Newer than the system headers may know
+enum
+{
+  madv_collapse       = 25,
+  pr_set_memory_merge = 67
+};
+
+// Touch the_depth bytes of stack below the caller, one write per page
+static void __attribute__((noinline))
+prefault_stack(
+    const std::size_t the_depth,
+    const std::size_t the_page) noexcept
+{
+  volatile char* __stack = static_cast<volatile char*>(::alloca(the_depth));
+
+  for (std::size_t i = 0; i < the_depth; i += the_page)
+    __stack[i] = 0;
+}
+
+} // End of egg::helper namespace
+
+// Implementation
+void
+process::__lock_memory()
+{
+  if (!__f_req_memory_lock)
+    return;
+
+  // Resident now and on every later mapping
+  if (::mlockall(MCL_CURRENT | MCL_FUTURE))
+  {
+    throw std::system_error(errno, std::system_category(), "mlockall() failed");
+  }
+
+  const std::size_t __page = ::sysconf(_SC_PAGESIZE);
+
+  // Stack depth the main cycle may use, within the stack limit
+  std::size_t __depth = _stack_prefault;
+
+  struct rlimit __stack;
+  if (0 == ::getrlimit(RLIMIT_STACK, &__stack) && RLIM_INFINITY != __stack.rlim_cur)
+  {
+    const std::size_t __margin = 64 * __page;
+    const std::size_t __limit  = (__stack.rlim_cur > __margin
+        ? __stack.rlim_cur - __margin
+        : 0);
+
+    if (__depth > __limit)
+      __depth = __limit;
+  }
+
+  if (__depth)
+    helper::prefault_stack(__depth, __page);
+
+  // Heap reserve kept in the arena: no trimming, no mmap() chunks
+  if (_heap_reserve)
+  {
+    ::mallopt(M_TRIM_THRESHOLD, -1);
+    ::mallopt(M_MMAP_MAX, 0);
+
+    char* __heap = static_cast<char*>(std::malloc(_heap_reserve));
+    if (!__heap)
+    {
+      throw std::system_error(
+        std::make_error_code(std::errc::not_enough_memory),
+        "Heap reserve failed");
+    }
+
+    for (std::size_t i = 0; i < _heap_reserve; i += __page)
+      __heap[i] = 0;
+
+    std::free(__heap);
+  }
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(
+        LOG_DEBUG,
+        "Memory locked, %zu bytes of stack and %zu bytes of heap prefaulted",
+        __depth,
+        _heap_reserve);
+  }
+}
+
+void
+process::__advise_memory()
+{
+  // Whole process and its forks: no huge pages at all
+  if (__f_req_huge_pages && "never" == _huge_pages)
+  {
+    if (::prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0))
+    {
+      throw std::system_error(errno, std::system_category(), "prctl(PR_SET_THP_DISABLE) failed");
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Transparent huge pages disabled");
+    }
+  }
+
+  // Regions registered before the property was set
+  for (const region& r : _regions)
+    __advise_region(r.address, r.size);
+
+  // Hot regions are populated by now: collapse them at once instead
+  // of waiting for khugepaged
+  if (__f_req_huge_collapse && "never" != _huge_pages)
+  {
+    const auto __start = std::chrono::steady_clock::now();
+    std::size_t __collapsed = 0;
+
+    for (const region& r : _regions)
+    {
+      if (0 == ::madvise(r.address, r.size, helper::madv_collapse))
+      {
+        ++__collapsed;
+      }
+      else if (__f_req_syslog)
+      {
+        ::syslog(
+            LOG_WARNING,
+            "MADV_COLLAPSE of %p failed: %s",
+            r.address,
+            std::strerror(errno));
+      }
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(
+          LOG_DEBUG,
+          "Collapsed %zu of %zu regions in %lld us",
+          __collapsed,
+          _regions.size(),
+          static_cast<long long>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - __start).count()));
+    }
+  }
+
+  // KSM for the whole process and the workers forked from it, the
+  // registered regions only on kernels before 6.4
+  if (__f_req_memory_merge)
+  {
+    if (0 == ::prctl(helper::pr_set_memory_merge, 1, 0, 0, 0))
+    {
+      if (__f_req_syslog && __f_trace)
+      {
+        ::syslog(LOG_DEBUG, "Memory merge enabled for the process");
+      }
+    }
+    else if (EINVAL == errno)
+    {
+      for (const region& r : _regions)
+      {
+        if (::madvise(r.address, r.size, MADV_MERGEABLE))
+        {
+          throw std::system_error(errno, std::system_category(), "madvise(MADV_MERGEABLE) failed");
+        }
+      }
+
+      if (__f_req_syslog && __f_trace)
+      {
+        ::syslog(LOG_DEBUG, "Memory merge enabled for %zu regions", _regions.size());
+      }
+    }
+    else
+    {
+      throw std::system_error(errno, std::system_category(), "prctl(PR_SET_MEMORY_MERGE) failed");
+    }
+  }
+}
+
+void
+process::__advise_region(
+    void*             the_address,
+    const std::size_t the_size) noexcept
+{
+  if (!__f_req_huge_pages || "advise" != _huge_pages)
+    return;
+
+  if (::madvise(the_address, the_size, MADV_HUGEPAGE) && __f_req_syslog)
+  {
+    ::syslog(
+        LOG_WARNING,
+        "MADV_HUGEPAGE of %p failed: %s",
+        the_address,
+        std::strerror(errno));
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
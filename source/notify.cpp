@@ -0,0 +1,267 @@
+/*!
+ *	\file		notify.cpp
+ *	\brief		Implements service manager notifications (NOTIFY_SOCKET protocol)
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+#include <poll.h>
+#include <stddef.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+bool
+process::notify(
+    const std::string& the_state) noexcept
+{
+  if (_notify_fd < 0)
+    return false;
+
+  return (0 <= ::send(_notify_fd, the_state.data(), the_state.size(), MSG_NOSIGNAL | MSG_DONTWAIT));
+}
+
+bool
+process::set_status(
+    const std::string& the_status) noexcept
+{
+  if (_notify_fd < 0)
+    return false;
+
+  try
+  {
+    return notify("STATUS=" + the_status);
+  }
+  catch (const std::bad_alloc&)
+  {
+    return false;
+  }
+}
+
+// Implementation
+void
+process::__open_notify()
+{
+  if (!__f_req_notify || _notify_fd >= 0)
+    return;
+
+  const char* __path = ::getenv("NOTIFY_SOCKET");
+  if (!__path || ('/' != __path[0] && '@' != __path[0]))
+    return;
+
+  struct sockaddr_un __address;
+  std::memset(&__address, 0, sizeof(__address));
+  __address.sun_family = AF_UNIX;
+
+  const std::size_t __size = std::strlen(__path);
+  if (__size >= sizeof(__address.sun_path))
+  {
+    throw std::system_error(
+      std::make_error_code(std::errc::filename_too_long),
+      "Wrong NOTIFY_SOCKET");
+  }
+
+  std::memcpy(__address.sun_path, __path, __size);
+
+  // Abstract namespace
+  if ('@' == __address.sun_path[0])
+    __address.sun_path[0] = '\0';
+
+  const int __fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (__fd < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "socket() failed");
+  }
+
+  if (::connect(
+        __fd,
+        reinterpret_cast<struct sockaddr*>(&__address),
+        offsetof(struct sockaddr_un, sun_path) + __size))
+  {
+    std::error_code ec(errno, std::system_category());
+    ::close(__fd);
+
+    throw std::system_error(ec, "NOTIFY_SOCKET connect() failed");
+  }
+
+  _notify_fd = __fd;
+
+  // Keepalive period requested by the manager, for this process only
+  _watchdog_interval = std::chrono::microseconds(0);
+
+  const char* __usec = ::getenv("WATCHDOG_USEC");
+  const char* __pid  = ::getenv("WATCHDOG_PID");
+
+  if (__usec && (!__pid || std::strtol(__pid, nullptr, 10) == ::getpid()))
+  {
+    _watchdog_interval = std::chrono::microseconds(std::strtoull(__usec, nullptr, 10));
+  }
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(
+        LOG_DEBUG,
+        "Notifying \"%s\", watchdog %lld us",
+        __path,
+        static_cast<long long>(_watchdog_interval.count()));
+  }
+}
+
+void
+process::__start_watchdog()
+{
+  if (_notify_fd < 0 ||
+      _watchdog_interval.count() <= 0 ||
+      _watchdog_thread.joinable())
+    return;
+
+  // Twice per interval
+  const long long __period = _watchdog_interval.count() * 1000 / 2;
+
+  struct itimerspec __timer;
+  __timer.it_interval.tv_sec  = __period / 1000000000;
+  __timer.it_interval.tv_nsec = __period % 1000000000;
+  __timer.it_value            = __timer.it_interval;
+
+  const int __timer_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  const int __wake_fd  = ::eventfd(0, EFD_CLOEXEC);
+
+  if (__timer_fd < 0 || __wake_fd < 0 ||
+      ::timerfd_settime(__timer_fd, 0, &__timer, nullptr))
+  {
+    std::error_code ec(errno, std::system_category());
+
+    if (__timer_fd >= 0)
+      ::close(__timer_fd);
+
+    if (__wake_fd >= 0)
+      ::close(__wake_fd);
+
+    throw std::system_error(ec, "Watchdog timer failed");
+  }
+
+  _watchdog_wake = __wake_fd;
+  _watchdog_kicks = 0;
+
+  // Gating is fixed for the thread lifetime
+  const bool __is_gated = __f_req_watchdog;
+
+  _watchdog_thread = signal::controller::start_thread([this, __timer_fd, __is_gated]()
+  {
+    struct pollfd __poll[2];
+    __poll[0].fd     = __timer_fd;
+    __poll[0].events = POLLIN;
+    __poll[1].fd     = _watchdog_wake;
+    __poll[1].events = POLLIN;
+
+    std::uint64_t __seen = _watchdog_kicks.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+      __poll[0].revents = __poll[1].revents = 0;
+
+      if (::poll(__poll, 2, -1) < 0)
+      {
+        if (EINTR == errno)
+          continue;
+
+        break;
+      }
+
+      // Stop requested
+      if (__poll[1].revents)
+        break;
+
+      std::uint64_t __expirations = 0;
+      if (0 > ::read(__timer_fd, &__expirations, sizeof(__expirations)))
+        continue;
+
+      // Gated: no progress since the last keepalive, let it expire
+      if (__is_gated)
+      {
+        const std::uint64_t __kicks = _watchdog_kicks.load(std::memory_order_relaxed);
+        if (__kicks == __seen)
+          continue;
+
+        __seen = __kicks;
+      }
+
+      notify("WATCHDOG=1");
+    }
+
+    ::close(__timer_fd);
+  });
+}
+
+void
+process::__stop_watchdog() noexcept
+{
+  if (_watchdog_thread.joinable())
+  {
+    const std::uint64_t __one = 1;
+    if (0 > ::write(_watchdog_wake, &__one, sizeof(__one)))
+    {
+      // Counter overflow only
+    }
+
+    _watchdog_thread.join();
+  }
+
+  if (_watchdog_wake >= 0)
+  {
+    ::close(_watchdog_wake);
+    _watchdog_wake = -1;
+  }
+}
+
+void
+process::__notify_error(
+    const int the_error) noexcept
+{
+  if (_notify_fd < 0)
+    return;
+
+  char __state[32];
+  std::snprintf(__state, sizeof(__state), "ERRNO=%d", the_error);
+
+  if (0 > ::send(_notify_fd, __state, std::strlen(__state), MSG_NOSIGNAL | MSG_DONTWAIT))
+  {
+    // Manager gone
+  }
+}
+
+void
+process::__close_notify() noexcept
+{
+  __stop_watchdog();
+
+  if (_notify_fd >= 0)
+  {
+    ::close(_notify_fd);
+    _notify_fd = -1;
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
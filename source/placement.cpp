@@ -0,0 +1,198 @@
+/*!
+ *	\file		placement.cpp
+ *	\brief		Implements CPU affinity and NUMA memory placement
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/syscall.h>
+
+#include <sched.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Memory policies of <linux/mempolicy.h>
+enum
+{
+  mpol_preferred      = 1,
+  mpol_preferred_many = 5,
+  mpol_mf_move        = (1 << 1)
+};
+
+// Node mask of the list, 1024 nodes at most
+struct EGG_PRIVATE node_mask
+{
+  enum
+  {
+    bits = 1024,
+    word = sizeof(unsigned long) * CHAR_BIT
+  };
+
+  explicit node_mask(
+      const std::vector<unsigned>& the_nodes) noexcept
+  {
+    std::memset(_mask, 0, sizeof(_mask));
+
+    for (const unsigned n : the_nodes)
+      _mask[n / word] |= 1UL << (n % word);
+  }
+
+  unsigned long _mask[bits / word];
+};
+
+// Preferred nodes policy, -1 and errno set on failure
+static long
+prefer(
+    const std::vector<unsigned>& the_nodes,
+    void*                        the_address,
+    const std::size_t            the_size) noexcept
+{
+#if HAVE_SET_MEMPOLICY
+
+  const node_mask __many(the_nodes);
+  const node_mask __one(std::vector<unsigned>(1, the_nodes.front()));
+
+  // One node or many, older kernels take the first one
+  int __mode = (the_nodes.size() > 1 ? mpol_preferred_many : mpol_preferred);
+
+  for (;;)
+  {
+    const node_mask& __used = (mpol_preferred_many == __mode ? __many : __one);
+
+    const long __result = (the_address
+        ? ::syscall(
+            SYS_mbind,
+            the_address,
+            the_size,
+            __mode,
+            __used._mask,
+            node_mask::bits + 1,
+            mpol_mf_move)
+        : ::syscall(
+            SYS_set_mempolicy,
+            __mode,
+            __used._mask,
+            node_mask::bits + 1));
+
+    if (__result < 0 && EINVAL == errno && mpol_preferred_many == __mode)
+    {
+      __mode = mpol_preferred;
+      continue;
+    }
+
+    return __result;
+  }
+
+#else
+
+  errno = ENOSYS;
+  return -1;
+
+#endif
+}
+
+} // End of egg::helper namespace
+
+// Implementation
+void
+process::__set_placement()
+{
+  // Main thread CPUs, inherited by the threads and the forks
+  if (!_cpus.empty())
+  {
+    cpu_set_t __set;
+    CPU_ZERO(&__set);
+
+    for (const unsigned c : _cpus)
+      CPU_SET(c, &__set);
+
+    if (::sched_setaffinity(0, sizeof(__set), &__set))
+    {
+      std::error_code ec(errno, std::system_category());
+
+      std::string msg("Failed to bind to CPUs ");
+      msg.append(_cpu_affinity);
+
+      throw std::system_error(ec, msg);
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Bound to CPUs %s", _cpu_affinity.c_str());
+    }
+  }
+
+  // Memory policy before before() allocates the state
+  if (!_nodes.empty())
+  {
+    if (helper::prefer(_nodes, nullptr, 0) < 0)
+    {
+      std::error_code ec(errno, std::system_category());
+
+      // No NUMA support: nothing to place
+      if (ENOSYS == ec.value())
+      {
+        if (__f_req_syslog)
+        {
+          ::syslog(LOG_WARNING, "NUMA not supported, node %s ignored", _numa_node.c_str());
+        }
+
+        return;
+      }
+
+      std::string msg("Failed to prefer NUMA nodes ");
+      msg.append(_numa_node);
+
+      throw std::system_error(ec, msg);
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Preferred NUMA nodes %s", _numa_node.c_str());
+    }
+  }
+}
+
+void
+process::__place_region(
+    void*             the_address,
+    const std::size_t the_size) noexcept
+{
+  if (_nodes.empty())
+    return;
+
+  // Pages touched before the policy are moved
+  if (helper::prefer(_nodes, the_address, the_size) < 0 && __f_req_syslog)
+  {
+    ::syslog(
+        LOG_WARNING,
+        "Failed to place region %p on NUMA nodes %s: %s",
+        the_address,
+        _numa_node.c_str(),
+        std::strerror(errno));
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
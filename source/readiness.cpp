@@ -0,0 +1,211 @@
+/*!
+ *	\file		readiness.cpp
+ *	\brief		Implements readiness handshake with the launching parent
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Status record, written at once (below PIPE_BUF)
+struct EGG_PRIVATE ready_record
+{
+  enum { signature = 0x52474745 };  // "EGGR"
+
+  std::uint32_t magic;
+  std::int32_t  error;
+  std::uint32_t phase;
+  std::uint32_t reserved;
+  std::uint64_t timestamp[static_cast<std::size_t>(process::stage::count)];
+};
+
+} // End of egg::helper namespace
+
+// Implementation
+void
+process::__open_ready()
+{
+  if (!__f_req_readiness || !__f_is_daemon || _ready_fd[0] >= 0)
+    return;
+
+  if (::pipe2(_ready_fd, O_CLOEXEC))
+  {
+    throw std::system_error(errno, std::system_category(), "pipe2() failed");
+  }
+}
+
+void
+process::__await_ready()
+{
+  if (_ready_fd[0] < 0)
+    return;
+
+  // Only the daemon holds the write end from now on
+  ::close(_ready_fd[1]);
+  _ready_fd[1] = -1;
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "Waiting for readiness ...");
+  }
+
+  helper::ready_record __record;
+  std::memset(&__record, 0, sizeof(__record));
+
+  ssize_t __count = -1;
+  int     __error = 0;
+
+  const auto __deadline = std::chrono::steady_clock::now() + _ready_timeout;
+
+  for (;;)
+  {
+    const auto __left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        __deadline - std::chrono::steady_clock::now()).count();
+
+    struct pollfd __poll;
+    __poll.fd      = _ready_fd[0];
+    __poll.events  = POLLIN;
+    __poll.revents = 0;
+
+    const int __ready = (__left > 0
+        ? ::poll(&__poll, 1, static_cast<int>(__left))
+        : 0);
+
+    if (__ready < 0 && EINTR == errno)
+      continue;
+
+    if (__ready < 0)
+    {
+      __error = errno;
+    }
+    else if (0 == __ready)
+    {
+      __error = ETIMEDOUT;
+    }
+    else
+    {
+      __count = ::read(_ready_fd[0], &__record, sizeof(__record));
+
+      if (__count < 0 && EINTR == errno)
+        continue;
+    }
+
+    break;
+  }
+
+  ::close(_ready_fd[0]);
+  _ready_fd[0] = -1;
+
+  if (__error)
+  {
+    if (__f_req_syslog)
+    {
+      ::syslog(LOG_ERR, "Daemon readiness not reported: %s", std::strerror(__error));
+    }
+
+    throw std::system_error(__error, std::system_category(), "Daemon readiness failed");
+  }
+
+  // Gone without a word
+  if (sizeof(__record) != __count ||
+      helper::ready_record::signature != __record.magic)
+  {
+    if (__f_req_syslog)
+    {
+      ::syslog(LOG_ERR, "Daemon exited before readiness");
+    }
+
+    throw std::system_error(
+      std::make_error_code(std::errc::no_child_process),
+      "Daemon exited before readiness");
+  }
+
+  // The daemon timing as seen by the launcher
+  std::memcpy(_timestamp, __record.timestamp, sizeof(_timestamp));
+  _phase = __record.phase;
+
+  if (__record.error)
+  {
+    if (__f_req_syslog)
+    {
+      ::syslog(
+          LOG_ERR,
+          "Daemon failed in phase \"%s\": %s",
+          to_string(get_phase()),
+          std::strerror(__record.error));
+    }
+
+    throw std::system_error(
+      __record.error,
+      std::system_category(),
+      "Daemon start-up failed");
+  }
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "Daemon is ready");
+  }
+}
+
+void
+process::__notify_ready(
+    const int the_error) noexcept
+{
+  if (_ready_fd[1] < 0)
+    return;
+
+  helper::ready_record __record;
+  std::memset(&__record, 0, sizeof(__record));
+
+  __record.magic = helper::ready_record::signature;
+  __record.error = the_error;
+  __record.phase = _phase.load(std::memory_order_relaxed);
+  std::memcpy(__record.timestamp, _timestamp, sizeof(__record.timestamp));
+
+  if (0 > ::write(_ready_fd[1], &__record, sizeof(__record)))
+  {
+    // The launcher is gone
+  }
+
+  __close_ready();
+}
+
+void
+process::__close_ready() noexcept
+{
+  for (int& fd : _ready_fd)
+  {
+    if (fd >= 0)
+    {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -9,24 +9,35 @@
 
 // System
 #include <sys/types.h>
+#include <sys/file.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 
 #include <fcntl.h>
 #include <grp.h>
+#include <poll.h>
 #include <pwd.h>
-#include <dirent.h>
+#include <sched.h>
 #include <syslog.h>
 #include <unistd.h>
 
 #include <cap-ng.h>
 
+#include <algorithm>
+#include <cctype>   // std::isspace
+#include <cstdio>   // std::snprintf
+#include <cstdlib>  // std::strtoul
 #include <cstring>  // std::memset
+#include <ctime>    // clock_gettime
+#include <thread>
 
 #include "common.h"
 
 #include <egg/runner/credentials.hpp>
+#include <egg/runner/descriptor.hpp>
 #include <egg/runner/runner.hpp>
+#include <egg/runner/scanner.hpp>
 
 
 namespace egg
@@ -58,6 +69,113 @@ void process(
 
 };
 
+// Parse non-negative integer property value
+static unsigned long
+to_unsigned(
+    const egg::variable& the_value)
+{
+  const std::string __text(the_value.as_string());
+  char* __end = nullptr;
+
+  errno = 0;
+  const unsigned long __result = std::strtoul(__text.c_str(), &__end, 0);
+
+  if (__text.empty() || *__end != '\0' || errno || __text[0] == '-')
+  {
+    std::string msg("Wrong numeric value \"");
+    msg.append(__text);
+    msg.append("\"");
+
+    throw std::system_error(
+      std::make_error_code(std::errc::invalid_argument), msg);
+  }
+
+  return __result;
+}
+
+// Add CAP_IPC_LOCK to the effective and permitted sets
+static int
+keep_ipc_lock() noexcept
+{
+  return capng_update(
+      CAPNG_ADD,
+      static_cast<capng_type_t>(CAPNG_EFFECTIVE | CAPNG_PERMITTED),
+      CAP_IPC_LOCK);
+}
+
+// Control file of the cgroup limit property, nullptr if not a limit
+static const char*
+cgroup_control(
+    const process::property the_property) noexcept
+{
+  switch (the_property)
+  {
+    case process::property::cpu_max:     return "cpu.max";
+    case process::property::cpu_weight:  return "cpu.weight";
+    case process::property::memory_high: return "memory.high";
+    case process::property::memory_max:  return "memory.max";
+    case process::property::io_weight:   return "io.weight";
+    default:                             break;
+  }
+
+  return nullptr;
+}
+
+// Parse "0-3,8,10-11" list property value, every item below the limit
+static std::vector<unsigned>
+to_list(
+    const egg::variable& the_value,
+    const unsigned       the_limit)
+{
+  const std::string __text(the_value.as_string());
+  std::vector<unsigned> __result;
+
+  auto __fail = [&__text]()
+  {
+    std::string msg("Wrong list value \"");
+    msg.append(__text);
+    msg.append("\"");
+
+    throw std::system_error(
+      std::make_error_code(std::errc::invalid_argument), msg);
+  };
+
+  for (const char* p = __text.c_str(); *p; )
+  {
+    char* __end = nullptr;
+
+    if (*p < '0' || *p > '9')
+      __fail();
+
+    const unsigned long __first = std::strtoul(p, &__end, 10);
+    unsigned long       __last  = __first;
+
+    if ('-' == *__end)
+    {
+      p = __end + 1;
+
+      if (*p < '0' || *p > '9')
+        __fail();
+
+      __last = std::strtoul(p, &__end, 10);
+    }
+
+    if (__last < __first || __last >= the_limit ||
+        (*__end != ',' && *__end != '\0'))
+      __fail();
+
+    for (unsigned long i = __first; i <= __last; ++i)
+      __result.push_back(static_cast<unsigned>(i));
+
+    p = (*__end ? __end + 1 : __end);
+  }
+
+  std::sort(__result.begin(), __result.end());
+  __result.erase(std::unique(__result.begin(), __result.end()), __result.end());
+
+  return __result;
+}
+
 } // End of sys::helper namespace
 
 // Process itself
@@ -74,12 +192,59 @@ process::process(
     __f_req_syslog(0),
     __f_req_cgroup(0),
     __f_switch_complete(0),
+    __f_req_pid_lock(0),
+    __f_req_instance(0),
+    __f_req_timing(0),
+    __f_req_upgrade(0),
+    __f_is_resumed(0),
+    __f_req_workers(0),
+    __f_req_supervisor(0),
+    __f_is_supervised(0),
+    __f_req_readiness(0),
+    __f_req_notify(0),
+    __f_req_watchdog(0),
+    __f_req_worker_cgroups(0),
+    __f_req_scheduler(0),
+    __f_req_nice(0),
+    __f_req_io_priority(0),
+    __f_req_timer_slack(0),
+    __f_req_memory_lock(0),
+    __f_req_huge_pages(0),
+    __f_req_huge_collapse(0),
+    __f_req_memory_merge(0),
     _description("Default process"),
     _uid(getuid()),
     _user(credentials::user_id_to_name(getuid())),
     _gid(getgid()),
     _group(credentials::group_id_to_name(getgid())),
-    _syslog_label("DMN")
+    _syslog_label("DMN"),
+    _pid_fd(-1),
+    _scan_threads(1),
+    _phase(static_cast<std::uint32_t>(phase::initial)),
+    _timestamp(),
+    _instance_fd(-1),
+    _instance_wake(-1),
+    _upgrade_signal(SIGUSR2),
+    _upgrade_requested(false),
+    _workers(0),
+    _worker(-1),
+    _ready_fd{ -1, -1 },
+    _ready_timeout(std::chrono::seconds(30)),
+    _notify_fd(-1),
+    _watchdog_interval(0),
+    _watchdog_wake(-1),
+    _watchdog_kicks(0),
+    _cgroup_root("/sys/fs/cgroup"),
+    _sched_policy(SCHED_OTHER),
+    _sched_priority(0),
+    _nice(0),
+    _io_priority(
+        (helper::ioprio_class_best_effort << helper::ioprio_class_shift) |
+        helper::ioprio_level_default),
+    _timer_slack(50000),
+    _stack_prefault(256 * 1024),
+    _heap_reserve(0),
+    _huge_pages("advise")
 {
   // Purify _name
   {
@@ -87,10 +252,19 @@ process::process(
     st = (std::string::npos == st ? 0 : ++st);
     _name = the_name.substr(st);
   }
+
+  _instance_label = _name;
 }
 
 process::~process() noexcept
 {
+  __release_instance();
+  __close_ready();
+  __close_notify();
+
+  if (_pid_fd >= 0)
+    ::close(_pid_fd);
+
   if (__f_req_syslog)
     ::closelog();
 }
@@ -98,6 +272,10 @@ process::~process() noexcept
 void
 process::execute()
 {
+  // Reset timing
+  std::memset(_timestamp, 0, sizeof(_timestamp));
+  __mark(stage::start);
+
   // Open syslog
   if (__f_req_syslog)
   {
@@ -115,39 +293,166 @@ process::execute()
     }
   }
 
+  // Service manager socket
+  __open_notify();
+
+  try
+  {
+    // Resume a handed over instance or start a new one
+    if (!__resume() && !__launch())
+      return;
+
+    // Answer status queries, once the worker pool is forked if any
+    if (!__f_req_workers)
+      __serve_instance();
+
+    // Last call
+    _phase = static_cast<std::uint32_t>(phase::after);
+    after();
+    __mark(stage::after);
+
+    // Warmed up: huge pages and merging, then no page faults
+    __advise_memory();
+    __lock_memory();
+  }
+  catch (const std::system_error& e)
+  {
+    __notify_error(e.code().value() ? e.code().value() : ECANCELED);
+    __notify_ready(e.code().value() ? e.code().value() : ECANCELED);
+    throw;
+  }
+  catch (...)
+  {
+    __notify_error(ECANCELED);
+    __notify_ready(ECANCELED);
+    throw;
+  }
+
+  // Report to the launcher and the service manager
+  __notify_ready(0);
+  notify("READY=1");
+
+  if (!__f_req_workers)
+    __start_watchdog();
+
+  // Start-up summary
+  __report_timing();
+
+  // Complete
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "Initialization complete!");
+  }
+
+  // Done
+  __f_switch_complete = 1;
+
+  // Main cycle
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "Starting main cycle ...");
+  }
+
+  // Hot upgrade on signal
+  __arm_upgrade();
+
+  // Main cycle
+  _phase = static_cast<std::uint32_t>(phase::run);
+
+  if (__f_req_workers)
+    __run_workers();
+  else
+    run();
+
+  _phase = static_cast<std::uint32_t>(phase::complete);
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "Main cycle complete!");
+  }
+
+  // Release the manager and the instance socket
+  notify("STOPPING=1");
+  __close_notify();
+
+  __release_instance();
+
+  // Remove pid, the supervisor owns it
+  if (!__f_is_supervised)
+    __remove_pid();
+}
+
+// Start-up sequence up to the PID file, false in the parents
+bool
+process::__launch()
+{
+  // Inherited listening sockets
+  __adopt_listen_fds();
+
   // Check if service is up
   __is_service_up();
+  __mark(stage::service_check);
 
   // Build directories
-  if (__f_req_pid_file)
-  {
-    std::string __path = _pid_path.substr(0, _pid_path.find_last_of('/'));
+  __make_pid_directory();
+  __mark(stage::directory);
 
-    if (__f_req_syslog && __f_trace)
-    {
-      ::syslog(LOG_DEBUG, "Create directory \"%s\" if required ...", __path.c_str());
-    }
+  // Resource limits and accounting from the start
+  __join_cgroup();
+  __mark(stage::cgroup);
 
-    credentials::create_directory(__path, _uid, _gid);
-  }
+  // Bind to CPUs and NUMA nodes before the state is allocated
+  __set_placement();
+  __mark(stage::placement);
 
   // Call before
+  _phase = static_cast<std::uint32_t>(phase::before);
   before();
+  __mark(stage::before);
+
+  // Resource limits, scheduling and the worker cgroups while the
+  // privileges are still held
+  __set_limits();
+  __mark(stage::limits);
+
+  __set_scheduling();
+  __mark(stage::scheduling);
+
+  __make_worker_cgroups();
+  __mark(stage::worker_cgroups);
 
   // Configure capabilities
   __set_capabilities();
+  __mark(stage::capabilities);
 
   // Set credentials
   __set_credentials();
+  __mark(stage::credentials);
 
   // Change working directory
   __cwd();
+  __mark(stage::working_directory);
+
+  // Readiness pipe across both forks
+  __open_ready();
 
   // First fork
   if (__f_is_daemon)
   {
     if (__fork())
-      return;
+    {
+      __await_ready();
+      return false;
+    }
+
+    // The read end stays with the launcher
+    if (_ready_fd[0] >= 0)
+    {
+      ::close(_ready_fd[0]);
+      _ready_fd[0] = -1;
+    }
+
+    __mark(stage::first_fork);
 
     __detach_terminal();
 
@@ -160,52 +465,53 @@ process::execute()
     {
       throw std::system_error(errno, std::system_category(), "setsid() failed");
     }
+
+    __mark(stage::session);
   }
 
   // Complete environment preset
   __in_between();
+  __mark(stage::in_between);
 
   // Between
+  _phase = static_cast<std::uint32_t>(phase::between);
   between();
+  __mark(stage::between);
 
   // Second fork
-  if (__f_is_daemon && __fork())
-    return;
+  if (__f_is_daemon)
+  {
+    if (__fork())
+    {
+      __close_ready();
+      return false;
+    }
+
+    __mark(stage::second_fork);
+  }
 
   // Initialize and set signal handlers not done since
   // the iheritated implementation could do it itself
 
   // Write PID file
   __write_pid();
+  __mark(stage::pid_file);
 
-  // Last call
-  after();
-
-  // Complete
-  if (__f_req_syslog && __f_trace)
+  if (_notify_fd >= 0)
   {
-    ::syslog(LOG_INFO, "Initialization complete!");
+    notify("MAINPID=" + std::to_string(::getpid()));
   }
 
-  // Done
-  __f_switch_complete = 1;
-
-  // Main cycle
-  if (__f_req_syslog && __f_trace)
+  // Stay resident and respawn the child
+  if (__f_req_supervisor && __supervise())
   {
-    ::syslog(LOG_INFO, "Starting main cycle ...");
-  }
-
-  // Main cycle
-  run();
+    __release_instance();
+    __remove_pid();
 
-  if (__f_req_syslog && __f_trace)
-  {
-    ::syslog(LOG_INFO, "Main cycle complete!");
+    return false;
   }
 
-  // Remove pid
-  __remove_pid();
+  return true;
 }
 
 /* Properties */
@@ -260,6 +566,78 @@ process::enable(
   {
     __f_req_cgroup = 1;
   }
+  else if(property::pid_lock == the_property)
+  {
+    __f_req_pid_lock = 1;
+  }
+  else if(property::instance_socket == the_property)
+  {
+    __f_req_instance = 1;
+  }
+  else if(property::timing == the_property)
+  {
+    __f_req_timing = 1;
+  }
+  else if(property::upgrade_signal == the_property)
+  {
+    __f_req_upgrade = 1;
+  }
+  else if(property::workers == the_property)
+  {
+    __f_req_workers = 1;
+  }
+  else if (property::supervisor == the_property)
+  {
+    __f_req_supervisor = 1;
+  }
+  else if (property::readiness == the_property)
+  {
+    __f_req_readiness = 1;
+  }
+  else if (property::notify == the_property)
+  {
+    __f_req_notify = 1;
+  }
+  else if (property::watchdog == the_property)
+  {
+    __f_req_watchdog = 1;
+  }
+  else if (property::worker_cgroups == the_property)
+  {
+    __f_req_worker_cgroups = 1;
+  }
+  else if (property::scheduler == the_property)
+  {
+    __f_req_scheduler = 1;
+  }
+  else if (property::nice == the_property)
+  {
+    __f_req_nice = 1;
+  }
+  else if (property::io_priority == the_property)
+  {
+    __f_req_io_priority = 1;
+  }
+  else if (property::timer_slack == the_property)
+  {
+    __f_req_timer_slack = 1;
+  }
+  else if (property::memory_lock == the_property)
+  {
+    __f_req_memory_lock = 1;
+  }
+  else if (property::huge_pages == the_property)
+  {
+    __f_req_huge_pages = 1;
+  }
+  else if (property::huge_collapse == the_property)
+  {
+    __f_req_huge_collapse = 1;
+  }
+  else if (property::memory_merge == the_property)
+  {
+    __f_req_memory_merge = 1;
+  }
 }
 
 void
@@ -300,6 +678,78 @@ process::disable(
   {
     __f_req_cgroup = 0;
   }
+  else if (property::pid_lock == the_property)
+  {
+    __f_req_pid_lock = 0;
+  }
+  else if (property::instance_socket == the_property)
+  {
+    __f_req_instance = 0;
+  }
+  else if (property::timing == the_property)
+  {
+    __f_req_timing = 0;
+  }
+  else if (property::upgrade_signal == the_property)
+  {
+    __f_req_upgrade = 0;
+  }
+  else if (property::workers == the_property)
+  {
+    __f_req_workers = 0;
+  }
+  else if (property::supervisor == the_property)
+  {
+    __f_req_supervisor = 0;
+  }
+  else if (property::readiness == the_property)
+  {
+    __f_req_readiness = 0;
+  }
+  else if (property::notify == the_property)
+  {
+    __f_req_notify = 0;
+  }
+  else if (property::watchdog == the_property)
+  {
+    __f_req_watchdog = 0;
+  }
+  else if (property::worker_cgroups == the_property)
+  {
+    __f_req_worker_cgroups = 0;
+  }
+  else if (property::scheduler == the_property)
+  {
+    __f_req_scheduler = 0;
+  }
+  else if (property::nice == the_property)
+  {
+    __f_req_nice = 0;
+  }
+  else if (property::io_priority == the_property)
+  {
+    __f_req_io_priority = 0;
+  }
+  else if (property::timer_slack == the_property)
+  {
+    __f_req_timer_slack = 0;
+  }
+  else if (property::memory_lock == the_property)
+  {
+    __f_req_memory_lock = 0;
+  }
+  else if (property::huge_pages == the_property)
+  {
+    __f_req_huge_pages = 0;
+  }
+  else if (property::huge_collapse == the_property)
+  {
+    __f_req_huge_collapse = 0;
+  }
+  else if (property::memory_merge == the_property)
+  {
+    __f_req_memory_merge = 0;
+  }
 }
 
 bool
@@ -339,6 +789,78 @@ process::status(
   {
     return (__f_req_cgroup ? true : false);
   }
+  else if (property::pid_lock == the_property)
+  {
+    return (__f_req_pid_lock ? true : false);
+  }
+  else if (property::instance_socket == the_property)
+  {
+    return (__f_req_instance ? true : false);
+  }
+  else if (property::timing == the_property)
+  {
+    return (__f_req_timing ? true : false);
+  }
+  else if (property::upgrade_signal == the_property)
+  {
+    return (__f_req_upgrade ? true : false);
+  }
+  else if (property::workers == the_property)
+  {
+    return (__f_req_workers ? true : false);
+  }
+  else if (property::supervisor == the_property)
+  {
+    return (__f_req_supervisor ? true : false);
+  }
+  else if (property::readiness == the_property)
+  {
+    return (__f_req_readiness ? true : false);
+  }
+  else if (property::notify == the_property)
+  {
+    return (__f_req_notify ? true : false);
+  }
+  else if (property::watchdog == the_property)
+  {
+    return (__f_req_watchdog ? true : false);
+  }
+  else if (property::worker_cgroups == the_property)
+  {
+    return (__f_req_worker_cgroups ? true : false);
+  }
+  else if (property::scheduler == the_property)
+  {
+    return (__f_req_scheduler ? true : false);
+  }
+  else if (property::nice == the_property)
+  {
+    return (__f_req_nice ? true : false);
+  }
+  else if (property::io_priority == the_property)
+  {
+    return (__f_req_io_priority ? true : false);
+  }
+  else if (property::timer_slack == the_property)
+  {
+    return (__f_req_timer_slack ? true : false);
+  }
+  else if (property::memory_lock == the_property)
+  {
+    return (__f_req_memory_lock ? true : false);
+  }
+  else if (property::huge_pages == the_property)
+  {
+    return (__f_req_huge_pages ? true : false);
+  }
+  else if (property::huge_collapse == the_property)
+  {
+    return (__f_req_huge_collapse ? true : false);
+  }
+  else if (property::memory_merge == the_property)
+  {
+    return (__f_req_memory_merge ? true : false);
+  }
 
   return false;
 }
@@ -404,89 +926,650 @@ process::set(
       ::syslog(LOG_DEBUG, "Change label to \"%s\"", _syslog_label.c_str());
     }
   }
+  else if (property::scan_threads == the_property)
+  {
+    _scan_threads = helper::to_unsigned(the_value);
+
+    // 0 means one per CPU
+    if (!_scan_threads)
+    {
+      _scan_threads = std::thread::hardware_concurrency();
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set scan threads to %u", _scan_threads);
+    }
+  }
+  else if (property::instance_socket == the_property)
+  {
+    _instance_label = the_value.as_string();
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set instance socket to \"@%s\"", _instance_label.c_str());
+    }
+  }
+  else if (property::upgrade_signal == the_property)
+  {
+    const unsigned long __signal = helper::to_unsigned(the_value);
+
+    if (!__signal || __signal >= egg::signal::controller::count)
+    {
+      std::string msg("Wrong upgrade signal ");
+      msg.append(the_value.as_string());
+
+      throw std::system_error(
+        std::make_error_code(std::errc::invalid_argument), msg);
+    }
+
+    _upgrade_signal = __signal;
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set upgrade signal to %d", _upgrade_signal);
+    }
+  }
+  else if (property::workers == the_property)
+  {
+    _workers = helper::to_unsigned(the_value);
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set worker count to %zu", _workers);
+    }
+  }
+  else if (property::cgroup == the_property)
+  {
+    std::string __path = the_value.as_string();
+
+    // Relative to the root, no way up
+    __path.erase(0, __path.find_first_not_of('/'));
+
+    if (("/" + __path + "/").find("/../") != std::string::npos)
+    {
+      std::string msg("Wrong cgroup path \"");
+      msg.append(__path);
+      msg.append("\"");
+
+      throw std::system_error(
+        std::make_error_code(std::errc::invalid_argument), msg);
+    }
+
+    _cgroup_path = __path;
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set cgroup to \"%s\"", _cgroup_path.c_str());
+    }
+  }
+  else if (property::cgroup_root == the_property)
+  {
+    _cgroup_root = the_value.as_string();
+
+    while (_cgroup_root.size() > 1 && '/' == _cgroup_root.back())
+      _cgroup_root.pop_back();
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set cgroup root to \"%s\"", _cgroup_root.c_str());
+    }
+  }
+  else if (const char* __control = helper::cgroup_control(the_property))
+  {
+    // Empty value leaves the file alone
+    const std::string __limit = the_value.as_string();
+
+    if (__limit.empty())
+      _cgroup_limits.erase(__control);
+    else
+      _cgroup_limits[__control] = __limit;
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set %s to \"%s\"", __control, __limit.c_str());
+    }
+  }
+  else if (property::scheduler == the_property)
+  {
+    __set_scheduler(the_value.as_string());
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set scheduler to %s", __get_scheduler().c_str());
+    }
+  }
+  else if (property::sched_priority == the_property)
+  {
+    __set_sched_priority(the_value.as_string());
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set scheduler priority to %d", _sched_priority);
+    }
+  }
+  else if (property::nice == the_property)
+  {
+    __set_nice(the_value.as_string());
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set nice level to %d", _nice);
+    }
+  }
+  else if (property::io_priority == the_property)
+  {
+    __set_io_priority(the_value.as_string());
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set I/O priority to %s", __get_io_priority().c_str());
+    }
+  }
+  else if (property::timer_slack == the_property)
+  {
+    _timer_slack = helper::to_unsigned(the_value);
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set timer slack to %lu ns", _timer_slack);
+    }
+  }
+  else if (property::stack_prefault == the_property)
+  {
+    _stack_prefault = helper::to_unsigned(the_value);
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set stack prefault to %zu bytes", _stack_prefault);
+    }
+  }
+  else if (property::heap_reserve == the_property)
+  {
+    _heap_reserve = helper::to_unsigned(the_value);
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set heap reserve to %zu bytes", _heap_reserve);
+    }
+  }
+  else if (property::huge_pages == the_property)
+  {
+    const std::string __mode(the_value.as_string());
+
+    if (__mode != "never" && __mode != "advise")
+    {
+      std::string msg("Wrong huge pages mode \"");
+      msg.append(__mode);
+      msg.append("\"");
+
+      throw std::system_error(
+        std::make_error_code(std::errc::invalid_argument), msg);
+    }
+
+    _huge_pages = __mode;
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set huge pages to %s", _huge_pages.c_str());
+    }
+  }
+  else if (property::cpu_affinity == the_property)
+  {
+    _cpus         = helper::to_list(the_value, CPU_SETSIZE);
+    _cpu_affinity = the_value.as_string();
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set CPU affinity to \"%s\"", _cpu_affinity.c_str());
+    }
+  }
+  else if (property::numa_node == the_property)
+  {
+    _nodes     = helper::to_list(the_value, 1024);
+    _numa_node = the_value.as_string();
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set NUMA nodes to \"%s\"", _numa_node.c_str());
+    }
+  }
+  else if (property::readiness == the_property)
+  {
+    _ready_timeout = std::chrono::milliseconds(helper::to_unsigned(the_value));
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(
+          LOG_DEBUG,
+          "Set readiness timeout to %lld ms",
+          static_cast<long long>(_ready_timeout.count()));
+    }
+  }
+}
+
+egg::variable
+process::get(
+    process::property the_property) const
+{
+  if (property::description == the_property)
+  {
+    return _description;
+  }
+  else if (property::user == the_property)
+  {
+    return _user;
+  }
+  else if (property::group == the_property)
+  {
+    return _group;
+  }
+  else if (property::working_directory == the_property)
+  {
+    return _working_directory;
+  }
+  else if (property::pid_file == the_property)
+  {
+    return _pid_path;
+  }
+  else if (property::syslog == the_property)
+  {
+    return _syslog_label;
+  }
+  else if (property::scan_threads == the_property)
+  {
+    return std::to_string(_scan_threads);
+  }
+  else if (property::instance_socket == the_property)
+  {
+    return _instance_label;
+  }
+  else if (property::upgrade_signal == the_property)
+  {
+    return std::to_string(_upgrade_signal);
+  }
+  else if (property::workers == the_property)
+  {
+    return std::to_string(_workers);
+  }
+  else if (property::readiness == the_property)
+  {
+    return std::to_string(_ready_timeout.count());
+  }
+  else if (property::cgroup == the_property)
+  {
+    return _cgroup_path;
+  }
+  else if (property::cgroup_root == the_property)
+  {
+    return _cgroup_root;
+  }
+  else if (const char* __control = helper::cgroup_control(the_property))
+  {
+    const auto __limit = _cgroup_limits.find(__control);
+
+    return (__limit == _cgroup_limits.end() ? std::string() : __limit->second);
+  }
+  else if (property::scheduler == the_property)
+  {
+    return __get_scheduler();
+  }
+  else if (property::sched_priority == the_property)
+  {
+    return std::to_string(_sched_priority);
+  }
+  else if (property::nice == the_property)
+  {
+    return std::to_string(_nice);
+  }
+  else if (property::io_priority == the_property)
+  {
+    return __get_io_priority();
+  }
+  else if (property::timer_slack == the_property)
+  {
+    return std::to_string(_timer_slack);
+  }
+  else if (property::stack_prefault == the_property)
+  {
+    return std::to_string(_stack_prefault);
+  }
+  else if (property::heap_reserve == the_property)
+  {
+    return std::to_string(_heap_reserve);
+  }
+  else if (property::huge_pages == the_property)
+  {
+    return _huge_pages;
+  }
+  else if (property::cpu_affinity == the_property)
+  {
+    return _cpu_affinity;
+  }
+  else if (property::numa_node == the_property)
+  {
+    return _numa_node;
+  }
+  else
+  {
+    return std::move(egg::variable());
+  }
+}
+
+/* Descriptors */
+void
+process::keep(
+    const int the_fd) noexcept
+{
+  if (the_fd >= 0 &&
+      _keep.end() == std::find(_keep.begin(), _keep.end(), the_fd))
+  {
+    _keep.push_back(the_fd);
+  }
+}
+
+void
+process::release(
+    const int the_fd) noexcept
+{
+  _keep.erase(std::remove(_keep.begin(), _keep.end(), the_fd), _keep.end());
 }
 
-egg::variable
-process::get(
-    process::property the_property) const
+/* Memory regions */
+void
+process::add_region(
+    void*                       the_address,
+    const std::size_t           the_size,
+    const spawner::inheritance  the_inheritance)
 {
-  if (property::description == the_property)
-  {
-    return _description;
-  }
-  else if (property::user == the_property)
+  spawner::set_inheritance(the_address, the_size, the_inheritance);
+  __place_region(the_address, the_size);
+  __advise_region(the_address, the_size);
+
+  auto __region = std::find_if(
+        _regions.begin(),
+        _regions.end(),
+        [the_address](const region& r) { return r.address == the_address; });
+
+  if (__region == _regions.end())
   {
-    return _user;
+    _regions.push_back(region{ the_address, the_size, the_inheritance });
   }
-  else if (property::group == the_property)
+  else
   {
-    return _group;
+    __region->size        = the_size;
+    __region->inheritance = the_inheritance;
   }
-  else if (property::working_directory == the_property)
+}
+
+void
+process::remove_region(
+    void* the_address) noexcept
+{
+  auto __region = std::find_if(
+        _regions.begin(),
+        _regions.end(),
+        [the_address](const region& r) { return r.address == the_address; });
+
+  if (__region == _regions.end())
+    return;
+
+  try
   {
-    return _working_directory;
+    spawner::set_inheritance(
+        __region->address,
+        __region->size,
+        spawner::inheritance::copy);
   }
-  else if (property::pid_file == the_property)
+  catch (const std::system_error&)
   {
-    return _pid_path;
+    // Unmapped already
   }
-  else if (property::syslog == the_property)
+
+  _regions.erase(__region);
+}
+
+bool
+process::is_final_instance() const noexcept
+{
+  return __f_switch_complete;
+}
+
+const char*
+process::to_string(
+    process::phase the_phase) noexcept
+{
+  switch (the_phase)
   {
-    return _syslog_label;
+  case phase::initial:  return "initial";
+  case phase::before:   return "before";
+  case phase::between:  return "between";
+  case phase::after:    return "after";
+  case phase::run:      return "run";
+  case phase::complete: return "complete";
   }
-  else
+
+  return "unknown";
+}
+
+std::chrono::nanoseconds
+process::get_duration(
+    process::stage the_stage) const noexcept
+{
+  if (the_stage >= stage::count)
+    return std::chrono::nanoseconds(0);
+
+  const std::size_t __index = static_cast<std::size_t>(the_stage);
+  if (!_timestamp[__index])
+    return std::chrono::nanoseconds(0);
+
+  // Skipped stages (no daemon) leave zero stamps
+  for (std::size_t i = __index; i > 0; --i)
   {
-    return std::move(egg::variable());
+    if (_timestamp[i - 1])
+      return std::chrono::nanoseconds(_timestamp[__index] - _timestamp[i - 1]);
   }
+
+  return std::chrono::nanoseconds(0);
 }
 
-bool
-process::is_final_instance() const noexcept
+const char*
+process::to_string(
+    process::stage the_stage) noexcept
 {
-  return __f_switch_complete;
+  switch (the_stage)
+  {
+  case stage::start:             return "start";
+  case stage::service_check:     return "service_check";
+  case stage::directory:         return "directory";
+  case stage::cgroup:            return "cgroup";
+  case stage::placement:         return "placement";
+  case stage::before:            return "before";
+  case stage::limits:            return "limits";
+  case stage::scheduling:        return "scheduling";
+  case stage::worker_cgroups:    return "worker_cgroups";
+  case stage::capabilities:      return "capabilities";
+  case stage::credentials:       return "credentials";
+  case stage::working_directory: return "working_directory";
+  case stage::first_fork:        return "first_fork";
+  case stage::session:           return "session";
+  case stage::in_between:        return "in_between";
+  case stage::between:           return "between";
+  case stage::second_fork:       return "second_fork";
+  case stage::pid_file:          return "pid_file";
+  case stage::after:             return "after";
+  case stage::count:             break;
+  }
+
+  return "unknown";
 }
 
 // Implementation
+void
+process::__mark(
+    process::stage the_stage) noexcept
+{
+  struct timespec __now;
+  ::clock_gettime(CLOCK_MONOTONIC, &__now);
+
+  _timestamp[static_cast<std::size_t>(the_stage)] =
+      static_cast<std::uint64_t>(__now.tv_sec) * 1000000000ULL + __now.tv_nsec;
+}
+
+void
+process::__report_timing() noexcept
+{
+  if (!__f_req_timing || !__f_req_syslog)
+    return;
+
+  // One line: "<stage>=<us> ... total=<us>"
+  char __line[1024];
+  int __offset = 0;
+  __line[0] = '\0';
+
+  for (std::size_t i = 1; i < static_cast<std::size_t>(stage::count); ++i)
+  {
+    const stage __stage = static_cast<stage>(i);
+
+    if (!_timestamp[i])
+      continue;
+
+    const int __count = std::snprintf(
+          __line + __offset,
+          sizeof(__line) - __offset,
+          "%s=%llu ",
+          to_string(__stage),
+          static_cast<unsigned long long>(get_duration(__stage).count() / 1000));
+
+    if (__count < 0 || __count >= static_cast<int>(sizeof(__line)) - __offset)
+      break;
+
+    __offset += __count;
+  }
+
+  const std::size_t __last = static_cast<std::size_t>(stage::after);
+
+  ::syslog(
+      LOG_INFO,
+      "Start-up timing (us): %stotal=%llu",
+      __line,
+      static_cast<unsigned long long>(
+        (_timestamp[__last] - _timestamp[0]) / 1000));
+}
+
 void
 process::__is_service_up()
 {
+  // Abstract socket: one bind() attempt
+  if (__f_req_instance)
+  {
+    __bind_instance();
+  }
+
+  // Locked PID file: created and locked right away, one non-blocking
+  // attempt. The lock is held across the forks up to __remove_pid()
+  if (__f_req_pid_file && __f_req_pid_lock)
+  {
+    __make_pid_directory();
+    __lock_pid(true);
+  }
+
+  // Settled without the PID probe and the /proc walk
+  if (__f_req_instance || (__f_req_pid_file && __f_req_pid_lock))
+    return;
+
   if (__f_req_pid_file)
   {
     int fd = open(_pid_path.c_str(), O_RDONLY | O_CLOEXEC);
 
+    // No PID file: nothing recorded. With pidfd support the file is
+    // authoritative and the /proc walk is not required
+    if (fd < 0 && ENOENT == errno && descriptor::has_pidfd())
+    {
+      if (__f_req_syslog && __f_trace)
+      {
+        ::syslog(LOG_DEBUG, "No PID file \"%s\" found", _pid_path.c_str());
+      }
+
+      return;
+    }
+
     // If pid file exists
     if (fd >= 0)
     {
-      const std::size_t Size = 64;
+      const std::size_t Size = 128;
       char txt[Size];
       std::memset(txt, '\0', Size);
-      ssize_t count = read(fd, txt, Size);
+      const ssize_t count = read(fd, txt, Size - 1);
+
+      // errno of read(), before close() may change it
+      const std::error_code ec(
+            (count < 0 ? errno : 0),
+            std::system_category());
+
+      ::close(fd);
 
       // Not readable. No credentials?
       if (count < 0)
       {
-        std::error_code ec(errno, std::system_category());
-
         if (__f_req_syslog && __f_trace)
-	{
+        {
           ::syslog(
             LOG_ERR,
-            "read(%d, %s, %ld): %s, %d",
-            fd, txt, Size, ec.message().c_str(), ec.value());
-	}
+            "read(\"%s\", %zu): %s, %d",
+            _pid_path.c_str(), Size - 1, ec.message().c_str(), ec.value());
+        }
+
+        std::string msg("Failed to read PID file \"");
+        msg.append(_pid_path);
+        msg.append("\"");
+
+        throw std::system_error(ec, msg);
+      }
+
+      // PID, then optional start time and boot id stamps
+      char* __next = nullptr;
+      pid_t __pid = std::strtol(txt, &__next, 10);
+
+      // Empty: created by a locked start that never got to write
+      if (__pid <= 0)
+      {
+        if (__f_req_syslog && __f_trace)
+        {
+          ::syslog(LOG_DEBUG, "Empty PID file \"%s\" ignored", _pid_path.c_str());
+        }
 
-        throw std::system_error(ec, "Pid file " );
+        return;
       }
+      unsigned long long __start = std::strtoull(__next, &__next, 10);
+
+      while (*__next && std::isspace(*__next))
+        ++__next;
 
-      // Check if process exists
-      pid_t __pid = std::strtol(txt, nullptr, 10);
+      std::string __boot(__next);
+      while (!__boot.empty() && std::isspace(__boot.back()))
+        __boot.pop_back();
 
       if (__f_req_syslog && __f_trace)
       {
         ::syslog(LOG_DEBUG, "Querying PID %d ...", __pid);
       }
 
-      if (kill(__pid, 0))
+      // Stamped PID file: settled by the pidfd and /proc/<pid>/stat
+      const int __alive = (__pid > 0 && __start
+          ? __probe(__pid, __start, __boot)
+          : -1);
+
+      if (__alive == 0)
+      {
+        if (__f_req_syslog)
+        {
+          ::syslog(LOG_INFO, "Ignoring stale PID file of process %d", __pid);
+        }
+
+        return;
+      }
+      else if (__alive < 0 && kill(__pid, 0))
       {
         std::error_code ec(errno, std::generic_category());
 
@@ -504,7 +1587,7 @@ process::__is_service_up()
       else
       {
         std::string msg("Process ");
-        msg.append(txt);
+        msg.append(std::to_string(__pid));
         msg.append(" exists");
 
         if (__f_req_syslog)
@@ -545,6 +1628,51 @@ process::__is_service_up()
   }
 }
 
+int
+process::__probe(
+    const pid_t         the_pid,
+    unsigned long long  the_start,
+    const std::string&  the_boot) noexcept
+{
+  // Recorded in the previous boot
+  if (!the_boot.empty())
+  {
+    const std::string __boot = egg::scanner::boot_id();
+
+    if (!__boot.empty() && __boot != the_boot)
+      return 0;
+  }
+
+  const int __fd = descriptor::pidfd_open(the_pid);
+  if (__fd < 0)
+  {
+    if (ESRCH == errno)
+      return 0;
+
+    // No pidfd support
+    return -1;
+  }
+
+  // The stamp is read while the pidfd pins the process
+  const unsigned long long __start = egg::scanner::start_time(the_pid);
+
+  // The pidfd becomes readable once the process has exited
+  struct pollfd __poll;
+  __poll.fd      = __fd;
+  __poll.events  = POLLIN;
+  __poll.revents = 0;
+
+  const int __exited = ::poll(&__poll, 1, 0);
+
+  ::close(__fd);
+
+  if (__exited != 0 || !__start)
+    return 0;
+
+  // Same PID, other process
+  return (__start == the_start ? 1 : 0);
+}
+
 // Capabilities
 void
 process::__set_capabilities() noexcept
@@ -563,6 +1691,10 @@ process::__set_capabilities() noexcept
 	"Unable to get capabilities");
     }
 
+    // Locking beyond RLIMIT_MEMLOCK
+    const bool __is_ipc_lock = (__f_req_memory_lock &&
+        capng_have_capability(CAPNG_PERMITTED, CAP_IPC_LOCK));
+
     capng_clear(CAPNG_SELECT_BOTH);
 
     if (capng_updatev(CAPNG_ADD, CAPNG_EFFECTIVE, CAP_SETUID, CAP_SETGID, -1) < 0)
@@ -581,6 +1713,14 @@ process::__set_capabilities() noexcept
 	"capng_updatev(.., CAPNG_PERMITTED)");
     }
 
+    if (__is_ipc_lock && helper::keep_ipc_lock() < 0)
+    {
+      throw std::system_error(
+	errno,
+	std::system_category(),
+	"capng_update(.., CAP_IPC_LOCK)");
+    }
+
     if (capng_apply(CAPNG_SELECT_BOTH) < 0)
     {
       throw std::system_error(
@@ -672,6 +1812,9 @@ process::__set_credentials()
   {
     try
     {
+      const bool __is_ipc_lock = (__f_req_memory_lock &&
+          capng_have_capability(CAPNG_PERMITTED, CAP_IPC_LOCK));
+
       capng_clear(CAPNG_SELECT_BOTH);
 
       if (capng_updatev(CAPNG_ADD, CAPNG_EFFECTIVE, CAP_SETUID, CAP_SETGID, -1))
@@ -690,6 +1833,15 @@ process::__set_credentials()
             "capng_updatev(.., CAPNG_PERMITTED)");
       }
 
+      // Kept over the switch for mlockall()
+      if (__is_ipc_lock && helper::keep_ipc_lock() < 0)
+      {
+        throw std::system_error(
+            errno,
+            std::system_category(),
+            "capng_update(.., CAP_IPC_LOCK)");
+      }
+
       if (capng_change_id(_uid, _gid, CAPNG_DROP_SUPP_GRP))
       {
         throw std::system_error(
@@ -893,21 +2045,24 @@ process::__fork()
   // Enable child signal
   _signal.release(SIGCLD);
 
-  pid_t pid = ::fork();
+  pid_t pid = -1;
 
+  try
+  {
+    pid = spawner::spawn();
+  }
   // Failed
-  if (pid < 0)
+  catch (const std::system_error&)
   {
-    std::error_code ec(errno, std::system_category());
-
     // Restore signals
     _signal.disable(SIGCHLD);
     _signal.release();
 
-    throw std::system_error(ec, "fork() failed");
+    throw;
   }
+
   // Parent
-  else if (pid != 0)
+  if (pid != 0)
   {
     int wait_status = 0;
 
@@ -974,12 +2129,20 @@ process::__detach_terminal()
   null_open(O_WRONLY, 1);
   null_open(O_WRONLY, 2);
 
-  // Close all open file descriptors other than stdin, stdout, stderr
-  int descriptor_count = ::getdtablesize();
-  for (int i = 3; i < descriptor_count; ++i)
-  {
-    ::close(i);
-  }
+  // Close all open file descriptors other than stdin, stdout, stderr,
+  // the PID file lock, the instance socket, the signal controller ones
+  // and the kept ones
+  std::vector<int> __keep(_signal.get_descriptors());
+  __keep.insert(__keep.end(), _keep.begin(), _keep.end());
+  __keep.push_back(_pid_fd);
+  __keep.push_back(_instance_fd);
+  __keep.push_back(_ready_fd[1]);
+  __keep.push_back(_notify_fd);
+
+  // The /proc descriptor of the scanner goes too: opened again on use
+  _scanner.reset();
+
+  descriptor::close_all(3, std::move(__keep));
 }
 
 void
@@ -1028,6 +2191,41 @@ process::__write_pid()
 	_pid_path.c_str());
   }
 
+  // PID, start time and boot id stamps
+  const pid_t __pid = getpid();
+  char __record[128];
+
+  const int __size = std::snprintf(
+        __record,
+        sizeof(__record),
+        "%d\n%llu\n%s\n",
+        __pid,
+        egg::scanner::start_time(__pid),
+        egg::scanner::boot_id().c_str());
+
+  // Locked PID file is rewritten in place and kept open
+  if (__f_req_pid_lock)
+  {
+    __lock_pid(true);
+
+    if (::ftruncate(_pid_fd, 0) ||
+        __size != ::pwrite(_pid_fd, __record, __size, 0))
+    {
+      std::error_code ec(errno, std::system_category());
+      std::string msg("Failed to write ");
+      msg.append(_pid_path);
+
+      if (__f_req_syslog)
+      {
+        ::syslog(LOG_ERR, "%s: %s, %d", msg.c_str(), ec.message().c_str(), ec.value());
+      }
+
+      throw std::system_error(ec, msg);
+    }
+
+    return;
+  }
+
   // Writing
   FILE* f = NULL;
   if (NULL == (f = ::fopen (_pid_path.c_str(), "w")))
@@ -1045,17 +2243,19 @@ process::__write_pid()
     throw std::system_error(ec, msg);
   }
 
-  // Write PID
-  if (0 > ::fprintf(f, "%d", getpid()))
+  // Write record
+  if (0 > ::fputs(__record, f))
   {
     std::error_code ec(errno, std::system_category());
-    std::string msg("fprintf() failed");
+    std::string msg("fputs() failed");
 
     if (__f_req_syslog)
     {
       ::syslog(LOG_ERR, "%s: %s, %d", msg.c_str(), ec.message().c_str(), ec.value());
     }
 
+    ::fclose(f);
+
     throw std::system_error(ec, msg);
   }
 
@@ -1064,114 +2264,176 @@ process::__write_pid()
 }
 
 void
-process::__remove_pid() noexcept
+process::__make_pid_directory()
 {
-  remove(_pid_path.c_str());
+  if (!__f_req_pid_file)
+    return;
+
+  const std::string __path = _pid_path.substr(0, _pid_path.find_last_of('/'));
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_DEBUG, "Create directory \"%s\" if required ...", __path.c_str());
+  }
+
+  credentials::create_directory(__path, _uid, _gid);
 }
 
-// Process utilities
-const pid_t
-process::exists(
-  const std::string  name)
+void
+process::__remove_pid() noexcept
 {
-  pid_t result = -1;
-  DIR* __process_dir = ::opendir("/proc");
+  remove(_pid_path.c_str());
 
-  if (!__process_dir)
+  // Unlock after removal so a new instance never sees our record
+  if (_pid_fd >= 0)
   {
-    throw std::system_error(errno, std::system_category(), "Failed to open /proc");
+    ::close(_pid_fd);
+    _pid_fd = -1;
   }
+}
+
+bool
+process::__lock_pid(
+    const bool is_create_required)
+{
+  if (_pid_fd >= 0)
+    return true;
 
-  const pid_t self_pid = getpid();
+  const int __flags = O_RDWR | O_CLOEXEC | O_NOCTTY |
+                      (is_create_required ? O_CREAT : 0);
 
-  // Iterate the /proc/<pid>
-  bool __is_matched = false;
-  char __buffer[512];
-  for (struct dirent* entry  = ::readdir(__process_dir);
-                      NULL  != entry;
-                      entry  = ::readdir(__process_dir))
+  // The owner unlinks the file before it unlocks: a lock taken on the
+  // unlinked inode guards nothing, the path is opened again then
+  for (;;)
   {
-    try
+    const int __fd = ::open(_pid_path.c_str(), __flags, 0644);
+    if (__fd < 0)
+    {
+      if (ENOENT == errno && !is_create_required)
+        return false;
+
+      std::error_code ec(errno, std::system_category());
+      std::string msg("Failed to open PID file ");
+      msg.append(_pid_path);
+
+      if (__f_req_syslog)
+      {
+        ::syslog(LOG_ERR, "%s: %s, %d", msg.c_str(), ec.message().c_str(), ec.value());
+      }
+
+      throw std::system_error(ec, msg);
+    }
+
+    // Open file description lock: shared by the forked copies of the
+    // descriptor and released with the last of them
+    struct flock __lock;
+    std::memset(&__lock, 0, sizeof(__lock));
+    __lock.l_type   = F_WRLCK;
+    __lock.l_whence = SEEK_SET;
+
+    int __result = ::fcntl(__fd, F_OFD_SETLK, &__lock);
+
+    // Kernels before 3.15
+    if (__result < 0 && EINVAL == errno)
+      __result = ::flock(__fd, LOCK_EX | LOCK_NB);
+
+    if (__result < 0)
     {
-      long __pid = std::stol(entry->d_name);
-      if (__pid == self_pid)
-        continue;
+      std::error_code ec(errno, std::system_category());
 
-      std::string __path("/proc/");
-      __path.append(entry->d_name);
-      __path.append("/cmdline");
+      char txt[32];
+      std::memset(txt, '\0', sizeof(txt));
+      const ssize_t count = ::pread(__fd, txt, sizeof(txt) - 1, 0);
 
-      FILE* __file = ::fopen(__path.c_str(), "r");
-      if (__file != NULL &&
-         ::fgets(__buffer, 512, __file) != NULL)
+      ::close(__fd);
+
+      if (EAGAIN == ec.value() || EACCES == ec.value() || EWOULDBLOCK == ec.value())
       {
-        std::string __cmd__line(__buffer);
-        if (__cmd__line.find(name) != std::string::npos)
+        // Not written yet by a concurrent start
+        const long __holder = (count > 0 ? std::strtol(txt, nullptr, 10) : 0);
+
+        std::string msg(__holder > 0
+            ? "Process " + std::to_string(__holder)
+            : std::string("Another process"));
+        msg.append(" holds the PID file ");
+        msg.append(_pid_path);
+
+        if (__f_req_syslog)
         {
-          __is_matched = true;
-          result = __pid;
+          ::syslog(LOG_ALERT, "%s", msg.c_str());
         }
+
+        throw std::system_error(
+          std::make_error_code(std::errc::device_or_resource_busy), msg);
       }
-      ::fclose(__file);
 
-      if (__is_matched)
-        break;
+      throw std::system_error(ec, "PID file lock");
     }
-    catch (const std::exception& e)
+
+    // Still the file at the path?
+    struct stat __locked;
+    struct stat __current;
+
+    if (::fstat(__fd, &__locked))
     {
-      // Do nothing
+      std::error_code ec(errno, std::system_category());
+      ::close(__fd);
+
+      throw std::system_error(ec, "PID file lock");
     }
-  }
 
-  ::closedir(__process_dir);
+    if (::stat(_pid_path.c_str(), &__current) ||
+        __locked.st_dev != __current.st_dev ||
+        __locked.st_ino != __current.st_ino)
+    {
+      ::close(__fd);
 
-  return result;
-}
+      if (__f_req_syslog && __f_trace)
+      {
+        ::syslog(LOG_DEBUG, "PID file \"%s\" replaced, locking again", _pid_path.c_str());
+      }
 
-void
-process::exists(
-  const std::string    name,
-  std::list<pid_t>&  result)
-{
-  DIR* __process_dir = ::opendir("/proc");
+      continue;
+    }
 
-  if (!__process_dir)
-  {
-    throw std::system_error(errno, std::system_category(), "Failed to open /proc");
+    _pid_fd = __fd;
+    break;
   }
 
-  // Iterate the /proc/<pid>
-  bool __is_matched = false;
-  char __buffer[512];
-  for (struct dirent* entry  = ::readdir(__process_dir);
-                      entry != NULL;
-                      entry  = ::readdir(__process_dir))
+  if (__f_req_syslog && __f_trace)
   {
-    try
-    {
-      long __pid = std::stol(entry->d_name);
+    ::syslog(LOG_DEBUG, "PID file \"%s\" locked", _pid_path.c_str());
+  }
 
-      std::string __path("/proc/");
-      __path.append(entry->d_name);
-      __path.append("/cmdline");
+  return true;
+}
 
-      FILE* __file = ::fopen(__path.c_str(), "r");
-      if (__file != NULL &&
-         ::fgets(__buffer, 512, __file) != NULL)
-      {
-        std::string __cmd__line(__buffer);
-        if (__cmd__line.find(name) != std::string::npos)
-          result.push_back(__pid);
-      }
-      ::fclose(__file);
-    }
-    catch (const std::exception& e)
-    {
-      // Do nothing
-    }
-  }
+// Process utilities
+egg::scanner&
+process::__get_scanner()
+{
+  if (!_scanner)
+    _scanner.reset(new egg::scanner());
+
+  return *_scanner;
+}
+
+const pid_t
+process::exists(
+  const std::string  name)
+{
+  return __get_scanner().find(name, getpid());
+}
+
+void
+process::exists(
+  const std::string    name,
+  std::vector<pid_t>&  result)
+{
+  egg::scanner& __scanner = __get_scanner();
+  __scanner.set_threads(_scan_threads);
 
-  ::closedir(__process_dir);
+  __scanner.find(name, result);
 }
 
 } // End of sys namespace
@@ -0,0 +1,435 @@
+/*!
+ *	\file		scanner.cpp
+ *	\brief		Implements /proc scanner
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#include "common.h"
+
+#include <egg/runner/scanner.hpp>
+#include <egg/runner/signal.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Joins the scan threads on every way out of find()
+struct EGG_PRIVATE joiner
+{
+
+explicit joiner(
+    std::vector<std::thread>& the_pool) noexcept
+  : _pool(the_pool)
+{
+}
+
+~joiner() noexcept
+{
+  for (auto& t : _pool)
+  {
+    if (t.joinable())
+      t.join();
+  }
+}
+
+std::vector<std::thread>& _pool;
+
+};
+
+} // End of egg::helper namespace
+
+// Kernel directory entry as returned by getdents64()
+struct linux_dirent64
+{
+  ino64_t        d_ino;
+  off64_t        d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[];
+};
+
+scanner::scanner(
+    const std::string& the_root)
+  : _root(the_root),
+    _fd(-1),
+    _directory_buffer(new char[directory_buffer_size]),
+    _cmdline_buffer(new char[cmdline_buffer_size]),
+    _threads(1),
+    _threshold(default_threshold)
+{
+  _fd = ::open(_root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if (_fd < 0)
+  {
+    std::error_code ec(errno, std::system_category());
+
+    std::string msg("Failed to open ");
+    msg.append(_root);
+
+    throw std::system_error(ec, msg);
+  }
+}
+
+scanner::~scanner() noexcept
+{
+  if (_fd >= 0)
+    ::close(_fd);
+}
+
+pid_t
+scanner::find(
+    const std::string& the_name,
+    const pid_t        the_skip)
+{
+  // Rewind
+  if (::lseek(_fd, 0, SEEK_SET) < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "lseek() failed");
+  }
+
+  const char*       __name = the_name.c_str();
+  const std::size_t __size = the_name.size();
+
+  for (long __count = __read_directory();
+            __count > 0;
+            __count = __read_directory())
+  {
+    for (long __offset = 0; __offset < __count;)
+    {
+      const linux_dirent64* __entry =
+          reinterpret_cast<const linux_dirent64*>(
+            _directory_buffer.get() + __offset);
+
+      __offset += __entry->d_reclen;
+
+      if (__entry->d_type != DT_DIR && __entry->d_type != DT_UNKNOWN)
+        continue;
+
+      const pid_t __pid = __to_pid(__entry->d_name);
+      if (__pid < 0 || __pid == the_skip)
+        continue;
+
+      if (__match(__pid, __name, __size, _cmdline_buffer.get()))
+        return __pid;
+    }
+  }
+
+  return -1;
+}
+
+void
+scanner::find(
+    const std::string&  the_name,
+    std::vector<pid_t>& the_result,
+    const pid_t         the_skip)
+{
+  const char*       __name = the_name.c_str();
+  const std::size_t __size = the_name.size();
+
+  __collect(the_skip);
+
+  // Serial fallback
+  if (_threads <= 1 || _candidates.size() < _threshold)
+  {
+    for (const pid_t __pid : _candidates)
+    {
+      if (__match(__pid, __name, __size, _cmdline_buffer.get()))
+        the_result.push_back(__pid);
+    }
+
+    return;
+  }
+
+  // Shard the table into contiguous ranges
+  const std::size_t __shards = _threads;
+  const std::size_t __step   = (_candidates.size() + __shards - 1) / __shards;
+
+  // Everything allocated before the first thread: nothing but the
+  // thread creation throws while they run
+  std::vector<std::vector<pid_t>>   __found(__shards);
+  std::vector<std::exception_ptr>   __errors(__shards);
+  std::unique_ptr<char[]>           __buffers(new char[(__shards - 1) * cmdline_buffer_size]);
+  std::vector<std::thread>          __pool;
+
+  for (auto& f : __found)
+    f.reserve(__step);
+
+  __pool.reserve(__shards - 1);
+  the_result.reserve(the_result.size() + _candidates.size());
+
+  auto __worker = [&](const std::size_t the_shard, char* the_buffer) noexcept
+  {
+    try
+    {
+      const std::size_t __begin = the_shard * __step;
+      const std::size_t __end   = std::min(__begin + __step, _candidates.size());
+
+      for (std::size_t i = __begin; i < __end; ++i)
+      {
+        if (__match(_candidates[i], __name, __size, the_buffer))
+          __found[the_shard].push_back(_candidates[i]);
+      }
+    }
+    catch (...)
+    {
+      __errors[the_shard] = std::current_exception();
+    }
+  };
+
+  {
+    // Joined on every way out, an exception included
+    helper::joiner __joiner(__pool);
+
+    try
+    {
+      for (std::size_t i = 1; i < __shards; ++i)
+      {
+        char* __buffer = __buffers.get() + (i - 1) * cmdline_buffer_size;
+
+        __pool.push_back(signal::controller::start_thread([&__worker, i, __buffer]()
+          {
+            __worker(i, __buffer);
+          }));
+      }
+    }
+    catch (const std::system_error&)
+    {
+      // Not enough threads: the calling thread picks the rest
+      for (std::size_t i = __pool.size() + 1; i < __shards; ++i)
+        __worker(i, _cmdline_buffer.get());
+    }
+
+    // The calling thread handles the first shard
+    __worker(0, _cmdline_buffer.get());
+  }
+
+  for (const auto& e : __errors)
+  {
+    if (e)
+      std::rethrow_exception(e);
+  }
+
+  // Merge, reserved above
+  for (const auto& f : __found)
+    the_result.insert(the_result.end(), f.begin(), f.end());
+}
+
+// Process stamps
+unsigned long long
+scanner::start_time(
+    const pid_t the_pid) noexcept
+{
+  char __path[32];
+  std::snprintf(__path, sizeof(__path), "/proc/%d/stat", the_pid);
+
+  const int __fd = ::open(__path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+  if (__fd < 0)
+    return 0;
+
+  char __buffer[1024];
+  const ssize_t __count = ::pread(__fd, __buffer, sizeof(__buffer) - 1, 0);
+
+  ::close(__fd);
+
+  if (__count <= 0)
+    return 0;
+
+  __buffer[__count] = '\0';
+
+  // Command may contain spaces and braces: start after the last one
+  const char* p = std::strrchr(__buffer, ')');
+  if (!p)
+    return 0;
+
+  // Skip fields 3 (state) to 21 (itrealvalue)
+  for (int i = 0; i < 20 && p; ++i)
+    p = std::strchr(p + 1, ' ');
+
+  return (p ? std::strtoull(p + 1, nullptr, 10) : 0);
+}
+
+std::string
+scanner::boot_id()
+{
+  const int __fd = ::open(
+        "/proc/sys/kernel/random/boot_id",
+        O_RDONLY | O_CLOEXEC | O_NOCTTY);
+
+  if (__fd < 0)
+    return std::string();
+
+  char __buffer[64];
+  const ssize_t __count = ::read(__fd, __buffer, sizeof(__buffer));
+
+  ::close(__fd);
+
+  if (__count <= 0)
+    return std::string();
+
+  std::string __result(__buffer, __count);
+  while (!__result.empty() && std::isspace(__result.back()))
+    __result.pop_back();
+
+  return __result;
+}
+
+// Implementation
+long
+scanner::__read_directory()
+{
+  const long __count = ::syscall(
+        SYS_getdents64,
+        _fd,
+        _directory_buffer.get(),
+        directory_buffer_size);
+
+  if (__count < 0)
+  {
+    std::error_code ec(errno, std::system_category());
+
+    std::string msg("getdents64() failed on ");
+    msg.append(_root);
+
+    throw std::system_error(ec, msg);
+  }
+
+  return __count;
+}
+
+void
+scanner::__collect(
+    const pid_t the_skip)
+{
+  // Rewind
+  if (::lseek(_fd, 0, SEEK_SET) < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "lseek() failed");
+  }
+
+  _candidates.clear();
+
+  for (long __count = __read_directory();
+            __count > 0;
+            __count = __read_directory())
+  {
+    for (long __offset = 0; __offset < __count;)
+    {
+      const linux_dirent64* __entry =
+          reinterpret_cast<const linux_dirent64*>(
+            _directory_buffer.get() + __offset);
+
+      __offset += __entry->d_reclen;
+
+      if (__entry->d_type != DT_DIR && __entry->d_type != DT_UNKNOWN)
+        continue;
+
+      const pid_t __pid = __to_pid(__entry->d_name);
+      if (__pid < 0 || __pid == the_skip)
+        continue;
+
+      _candidates.push_back(__pid);
+    }
+  }
+}
+
+bool
+scanner::__match(
+    const pid_t       the_pid,
+    const char*       the_name,
+    const std::size_t the_size,
+    char*             the_buffer) const noexcept
+{
+  // Build "<pid>/cmdline" without allocation
+  char __path[32];
+  char* p = __path + 12;
+  pid_t __pid = the_pid;
+
+  do
+  {
+    *--p = '0' + (__pid % 10);
+    __pid /= 10;
+  }
+  while (__pid);
+
+  const std::size_t __length = __path + 12 - p;
+  std::memmove(__path, p, __length);
+  std::memcpy(__path + __length, "/cmdline", sizeof("/cmdline"));
+
+  const int __fd = ::openat(_fd, __path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+  if (__fd < 0)
+    return false;
+
+  const ssize_t __count = ::pread(
+        __fd,
+        the_buffer,
+        cmdline_buffer_size,
+        0);
+
+  ::close(__fd);
+
+  if (__count <= 0)
+    return false;
+
+  // Match argv[0] only
+  const char* __end = static_cast<const char*>(
+        std::memchr(the_buffer, '\0', __count));
+
+  const std::size_t __argv0 = (__end
+      ? __end - the_buffer
+      : static_cast<std::size_t>(__count));
+
+  return (nullptr != ::memmem(
+        the_buffer,
+        __argv0,
+        the_name,
+        the_size));
+}
+
+pid_t
+scanner::__to_pid(
+    const char* the_name) noexcept
+{
+  if (*the_name == '\0')
+    return -1;
+
+  pid_t __pid = 0;
+
+  for (const char* p = the_name; *p; ++p)
+  {
+    if (*p < '0' || *p > '9' || __pid > 99999999)
+      return -1;
+
+    __pid = __pid * 10 + (*p - '0');
+  }
+
+  return __pid;
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -0,0 +1,291 @@
+/*!
+ *	\file		scheduling.cpp
+ *	\brief		Implements scheduling policy, nice, I/O priority and timer slack
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include <sched.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "common.h"
+
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+struct EGG_PRIVATE named
+{
+  const char* name;
+  int         value;
+};
+
+static const named scheduler_names[] =
+{
+  { "other",  SCHED_OTHER },
+  { "fifo",   SCHED_FIFO  },
+  { "rr",     SCHED_RR    },
+  { "batch",  SCHED_BATCH },
+  { "idle",   SCHED_IDLE  }
+};
+
+static const named io_class_names[] =
+{
+  { "none",        ioprio_class_none        },
+  { "realtime",    ioprio_class_realtime    },
+  { "best-effort", ioprio_class_best_effort },
+  { "idle",        ioprio_class_idle        }
+};
+
+template<std::size_t N>
+static int
+from_name(
+    const named       (&the_names)[N],
+    const std::string& the_name) noexcept
+{
+  for (const auto& n : the_names)
+  {
+    if (the_name == n.name)
+      return n.value;
+  }
+
+  return -1;
+}
+
+template<std::size_t N>
+static const char*
+to_name(
+    const named (&the_names)[N],
+    const int   the_value) noexcept
+{
+  for (const auto& n : the_names)
+  {
+    if (the_value == n.value)
+      return n.name;
+  }
+
+  return "unknown";
+}
+
+static void
+fail(
+    const char*        the_what,
+    const std::string& the_value)
+{
+  std::string msg("Wrong ");
+  msg.append(the_what);
+  msg.append(" \"");
+  msg.append(the_value);
+  msg.append("\"");
+
+  throw std::system_error(
+    std::make_error_code(std::errc::invalid_argument), msg);
+}
+
+} // End of egg::helper namespace
+
+// Values
+void
+process::__set_scheduler(
+    const std::string& the_value)
+{
+  const int __policy = helper::from_name(helper::scheduler_names, the_value);
+
+  if (__policy < 0)
+    helper::fail("scheduler", the_value);
+
+  _sched_policy = __policy;
+
+  // Realtime policies take no zero priority: start at the lowest one
+  if (__is_realtime() && !_sched_priority)
+    _sched_priority = ::sched_get_priority_min(_sched_policy);
+}
+
+void
+process::__set_sched_priority(
+    const std::string& the_value)
+{
+  char* __end = nullptr;
+  const long __priority = std::strtol(the_value.c_str(), &__end, 10);
+
+  // Realtime policies need 1..99, the others ignore it
+  if (the_value.empty() ||
+      *__end != '\0' ||
+      __priority < (__is_realtime() ? 1 : 0) ||
+      __priority > 99)
+    helper::fail("scheduler priority", the_value);
+
+  _sched_priority = static_cast<int>(__priority);
+}
+
+bool
+process::__is_realtime() const noexcept
+{
+  return (SCHED_FIFO == _sched_policy || SCHED_RR == _sched_policy);
+}
+
+void
+process::__set_nice(
+    const std::string& the_value)
+{
+  char* __end = nullptr;
+  const long __nice = std::strtol(the_value.c_str(), &__end, 10);
+
+  if (the_value.empty() || *__end != '\0' || __nice < -20 || __nice > 19)
+    helper::fail("nice level", the_value);
+
+  _nice = static_cast<int>(__nice);
+}
+
+void
+process::__set_io_priority(
+    const std::string& the_value)
+{
+  // "<class>[:<level>]"
+  const std::string::size_type __colon = the_value.find(':');
+  const int __class = helper::from_name(
+        helper::io_class_names,
+        the_value.substr(0, __colon));
+
+  // No level for "none": the kernel rejects any but zero
+  long __level = (helper::ioprio_class_none == __class ? 0 : helper::ioprio_level_default);
+
+  if (std::string::npos != __colon)
+  {
+    if (helper::ioprio_class_none == __class)
+      helper::fail("I/O priority", the_value);
+
+    char* __end = nullptr;
+    const char* __text = the_value.c_str() + __colon + 1;
+
+    __level = std::strtol(__text, &__end, 10);
+
+    if (*__text == '\0' || *__end != '\0' || __level < 0 || __level > 7)
+      helper::fail("I/O priority", the_value);
+  }
+
+  if (__class < 0)
+    helper::fail("I/O priority", the_value);
+
+  _io_priority = (__class << helper::ioprio_class_shift) | static_cast<int>(__level);
+}
+
+std::string
+process::__get_scheduler() const
+{
+  return helper::to_name(helper::scheduler_names, _sched_policy);
+}
+
+std::string
+process::__get_io_priority() const
+{
+  const int __class = _io_priority >> helper::ioprio_class_shift;
+
+  std::string __result(helper::to_name(helper::io_class_names, __class));
+
+  if (helper::ioprio_class_none == __class)
+    return __result;
+
+  __result.push_back(':');
+  __result.append(std::to_string(_io_priority & ((1 << helper::ioprio_class_shift) - 1)));
+
+  return __result;
+}
+
+// Implementation
+void
+process::__set_scheduling()
+{
+  // Slack first: it is per thread and inherited
+  if (__f_req_timer_slack)
+  {
+    if (::prctl(PR_SET_TIMERSLACK, _timer_slack, 0, 0, 0))
+    {
+      throw std::system_error(errno, std::system_category(), "PR_SET_TIMERSLACK failed");
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set timer slack to %lu ns", _timer_slack);
+    }
+  }
+
+  // Nice before the policy: realtime policies ignore it
+  if (__f_req_nice)
+  {
+    if (::setpriority(PRIO_PROCESS, 0, _nice))
+    {
+      throw std::system_error(errno, std::system_category(), "setpriority() failed");
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set nice level to %d", _nice);
+    }
+  }
+
+  if (__f_req_io_priority)
+  {
+    if (::syscall(SYS_ioprio_set, helper::ioprio_who_process, 0, _io_priority))
+    {
+      throw std::system_error(errno, std::system_category(), "ioprio_set() failed");
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(LOG_DEBUG, "Set I/O priority to %s", __get_io_priority().c_str());
+    }
+  }
+
+  if (__f_req_scheduler)
+  {
+    struct sched_param __param;
+    std::memset(&__param, 0, sizeof(__param));
+
+    // Priority is for the realtime policies only
+    if (__is_realtime())
+      __param.sched_priority = _sched_priority;
+
+    if (::sched_setscheduler(0, _sched_policy, &__param))
+    {
+      std::error_code ec(errno, std::system_category());
+
+      std::string msg("Failed to set scheduler ");
+      msg.append(__get_scheduler());
+
+      throw std::system_error(ec, msg);
+    }
+
+    if (__f_req_syslog && __f_trace)
+    {
+      ::syslog(
+          LOG_DEBUG,
+          "Set scheduler %s, priority %d",
+          __get_scheduler().c_str(),
+          __param.sched_priority);
+    }
+  }
+}
+
+} // End of egg namespace
+
+/* End of file */
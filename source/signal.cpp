@@ -7,7 +7,25 @@
  *	\version	1.0
  */
 
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
 #include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <egg/runner/signal.hpp>
 
@@ -34,14 +52,19 @@ handler::handler(
 // Stat
 stat::stat() noexcept
   : call_count(0),
-    error_count(0)
-{}
+    error_count(0),
+    overflow_count(0),
+    last_delivery(0)
+{
+  std::fill(handler_time, handler_time + histogram_size, 0);
+  std::fill(latency, latency + histogram_size, 0);
+}
 
 stat::stat(
     const stat& other) noexcept
-  : call_count(other.call_count),
-    error_count(other.error_count)
-{}
+{
+  *this = other;
+}
 
 stat&
 stat::operator=(
@@ -51,6 +74,11 @@ stat::operator=(
   {
     call_count = other.call_count;
     error_count = other.error_count;
+    overflow_count = other.overflow_count;
+    last_delivery = other.last_delivery;
+
+    std::copy(other.handler_time, other.handler_time + histogram_size, handler_time);
+    std::copy(other.latency, other.latency + histogram_size, latency);
   }
 
   return *this;
@@ -58,10 +86,8 @@ stat::operator=(
 
 stat::stat(
     stat&& other) noexcept
-  : call_count(other.call_count),
-    error_count(other.error_count)
 {
-  other.call_count = other.error_count = 0;
+  *this = std::move(other);
 }
 
 stat&
@@ -69,9 +95,10 @@ stat::operator=(stat&& other) noexcept
 {
   if (this != &other)
   {
-    call_count = other.call_count;
-    error_count = other.error_count;
-    other.call_count = other.error_count = 0;
+    const stat __empty;
+
+    *this = static_cast<const stat&>(other);
+    other = __empty;
   }
 
   return *this;
@@ -80,9 +107,267 @@ stat::operator=(stat&& other) noexcept
 stat::~stat() noexcept
 {}
 
+// Live counters, relaxed: each one is exact, the set is not a transaction
+struct counter
+{
+  std::atomic<unsigned long>	call_count;
+  std::atomic<unsigned long>	error_count;
+  std::atomic<unsigned long>	overflow_count;
+  std::atomic<unsigned long>	handler_time[stat::histogram_size];
+  std::atomic<unsigned long>	latency[stat::histogram_size];
+  std::atomic<std::uint64_t>	last_delivery;
+};
+
 // Controller
-static handler*	_s_handler[controller::count];
-static stat	_s_stat[controller::count];
+static std::atomic<handler*>	_s_handler[controller::count];
+static counter	_s_stat[controller::count];
+
+// Deferred modes: signal descriptor, queue and dispatcher wake event
+static std::atomic<controller::mode>	_s_mode(controller::mode::action);
+static int				_s_fd = -1;
+static int				_s_event = -1;
+static sigset_t				_s_routed;
+
+// Queue mode: bounded ring of many producers (any thread in the signal
+// context) and one consumer. A cell is free for the position p when its
+// sequence is p and ready when it is p + 1, so a producer interrupted
+// between the claim and the publication by another signal never blocks
+// the nested one: the consumer stops at the cell until it is published
+struct record
+{
+  std::atomic<std::size_t>	sequence;
+  int				id;
+  siginfo_t			info;
+  std::uint64_t			timestamp;
+};
+
+static record				_s_ring[controller::queue_size];
+static std::atomic<std::size_t>		_s_head(0);
+static std::size_t			_s_tail = 0;
+
+// Dispatcher thread
+static std::thread			_s_dispatcher;
+static std::atomic<bool>		_s_is_stopping(false);
+
+// Handler reclamation by epochs. A reader (the signal context or the
+// dispatch) counts itself in the parity of the epoch it observed, then
+// loads the slot. A writer swaps the slot and retires the former handler
+// with the current epoch. The epoch advances only when no reader of the
+// previous one is left, so a handler retired in the epoch E is not
+// reachable once the epoch is E + 2 and is deleted then. Writers never
+// wait for readers, readers never wait at all
+static std::atomic<std::uint64_t>	_s_epoch(0);
+static std::atomic<unsigned long>	_s_readers[2];
+static std::mutex			_s_writer;
+static std::vector<std::pair<handler*, std::uint64_t>>	_s_retired;
+
+// Enter the read section, returns the parity to leave it with
+static unsigned
+__enter() noexcept
+{
+  const unsigned __parity = _s_epoch.load() & 1;
+  _s_readers[__parity].fetch_add(1);
+
+  return __parity;
+}
+
+static void
+__leave(
+    const unsigned the_parity) noexcept
+{
+  _s_readers[the_parity].fetch_sub(1);
+}
+
+// Delete the handlers no reader may hold, under _s_writer
+static void
+__reclaim() noexcept
+{
+  // Two grace periods at most per call
+  for (int i = 0; i < 2; ++i)
+  {
+    const std::uint64_t __epoch = _s_epoch.load();
+
+    if (_s_readers[(__epoch + 1) & 1].load())
+      break;
+
+    _s_epoch.store(__epoch + 1);
+  }
+
+  const std::uint64_t __epoch = _s_epoch.load();
+
+  auto __end = std::remove_if(
+        _s_retired.begin(),
+        _s_retired.end(),
+        [__epoch](const std::pair<handler*, std::uint64_t>& r)
+        {
+          if (r.second + 2 > __epoch)
+            return false;
+
+          delete r.first;
+          return true;
+        });
+
+  _s_retired.erase(__end, _s_retired.end());
+}
+
+// Retire the handler taken out of its slot, under _s_writer
+static void
+__retire(
+    handler* the_handler) noexcept
+{
+  if (the_handler == nullptr)
+    return;
+
+  try
+  {
+    _s_retired.emplace_back(the_handler, _s_epoch.load());
+  }
+  catch (const std::bad_alloc&)
+  {
+    // Leaked rather than deleted under a reader
+  }
+
+  __reclaim();
+}
+
+// Monotonic time in ns, async-signal-safe
+static std::uint64_t
+__now() noexcept
+{
+  struct timespec __time;
+  ::clock_gettime(CLOCK_MONOTONIC, &__time);
+
+  return static_cast<std::uint64_t>(__time.tv_sec) * 1000000000ULL + __time.tv_nsec;
+}
+
+// Histogram bucket of the duration
+static std::size_t
+__bucket(
+    const std::uint64_t the_duration) noexcept
+{
+  const std::size_t __log = 63 - __builtin_clzll(the_duration | 1);
+
+  return std::min<std::size_t>(__log, stat::histogram_size - 1);
+}
+
+// Call the handler, the_queued is the time it was deferred at or 0
+static void
+__deliver(
+    int                 the_id,
+    siginfo_t*          the_info,
+    void*               the_context,
+    const std::uint64_t the_queued = 0) noexcept
+{
+  counter& c = _s_stat[the_id];
+
+  const unsigned __parity = __enter();
+  handler* __handler = _s_handler[the_id].load();
+
+  if (__handler == nullptr)
+  {
+    __leave(__parity);
+    c.error_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const std::uint64_t __start = __now();
+
+  __handler->process(the_id, the_info, the_context);
+
+  const std::uint64_t __end = __now();
+
+  __leave(__parity);
+
+  c.handler_time[__bucket(__end - __start)].fetch_add(1, std::memory_order_relaxed);
+
+  if (the_queued)
+  {
+    c.latency[__bucket(__start > the_queued ? __start - the_queued : 0)]
+        .fetch_add(1, std::memory_order_relaxed);
+  }
+
+  c.last_delivery.store(__start, std::memory_order_relaxed);
+  c.call_count.fetch_add(1, std::memory_order_release);
+}
+
+// Queue the signal and wake the consumer, async-signal-safe
+static void
+__push(
+    const int         the_id,
+    const siginfo_t*  the_info) noexcept
+{
+  const int __errno = errno;
+
+  std::size_t __position = _s_head.load(std::memory_order_relaxed);
+
+  for (;;)
+  {
+    record& r = _s_ring[__position % controller::queue_size];
+
+    const std::size_t __sequence = r.sequence.load(std::memory_order_acquire);
+    const std::intptr_t __distance =
+        static_cast<std::intptr_t>(__sequence - __position);
+
+    if (0 == __distance)
+    {
+      if (_s_head.compare_exchange_weak(
+            __position,
+            __position + 1,
+            std::memory_order_relaxed))
+        break;
+    }
+    else if (__distance < 0)
+    {
+      // Full
+      _s_stat[the_id].overflow_count.fetch_add(1, std::memory_order_relaxed);
+      errno = __errno;
+      return;
+    }
+    else
+      __position = _s_head.load(std::memory_order_relaxed);
+  }
+
+  record& r = _s_ring[__position % controller::queue_size];
+  r.id        = the_id;
+  r.info      = *the_info;
+  r.timestamp = __now();
+  r.sequence.store(__position + 1, std::memory_order_release);
+
+  const std::uint64_t __one = 1;
+  if (0 > ::write(_s_event, &__one, sizeof(__one)))
+  {
+    // Counter overflow only
+  }
+
+  errno = __errno;
+}
+
+// Call the handlers of the queued signals, the consumer only
+static std::size_t
+__drain() noexcept
+{
+  std::size_t __count = 0;
+
+  for (;;)
+  {
+    record& r = _s_ring[_s_tail % controller::queue_size];
+
+    if (r.sequence.load(std::memory_order_acquire) != _s_tail + 1)
+      break;
+
+    const int           __id     = r.id;
+    siginfo_t           __info   = r.info;
+    const std::uint64_t __queued = r.timestamp;
+
+    r.sequence.store(_s_tail + controller::queue_size, std::memory_order_release);
+    ++_s_tail;
+
+    __deliver(__id, &__info, nullptr, __queued);
+    ++__count;
+  }
+
+  return __count;
+}
 
 static void
 __signal_callback(
@@ -90,26 +375,277 @@ __signal_callback(
     siginfo_t*  the_info,
     void*       the_context)
 {
-  if (_s_handler[the_id] != nullptr)
+  if (controller::mode::queue == _s_mode.load(std::memory_order_acquire))
+    __push(the_id, the_info);
+  else
+    __deliver(the_id, the_info, the_context);
+}
+
+// Fork: the dispatcher is stopped around it and started again on both
+// sides, the writer lock keeps the slots and the retired list whole
+static bool				_s_is_restarted = false;
+static bool				_s_is_orphaned = false;
+
+static void
+__before_fork() noexcept
+{
+  _s_is_restarted = _s_is_orphaned = false;
+
+  if (_s_dispatcher.joinable())
+  {
+    // Forked by a handler on the dispatcher: it goes on in the child
+    if (std::this_thread::get_id() == _s_dispatcher.get_id())
+      _s_is_orphaned = true;
+    else
+    {
+      controller::instance().stop_dispatcher();
+      _s_is_restarted = true;
+    }
+  }
+
+  _s_writer.lock();
+}
+
+static void
+__restart_dispatcher() noexcept
+{
+  try
+  {
+    controller::instance().start_dispatcher();
+  }
+  catch (const std::system_error&)
+  {
+    // Out of threads: dispatch() still works
+  }
+}
+
+static void
+__after_fork_parent() noexcept
+{
+  _s_writer.unlock();
+
+  if (_s_is_restarted)
+    __restart_dispatcher();
+}
+
+// Same descriptor number, new open file: the controller descriptors
+// keep their numbers, a kept list built before fork() included
+static void
+__replace(
+    const int the_fd,
+    const int the_new) noexcept
+{
+  if (the_new < 0)
+    return;
+
+  ::dup3(the_new, the_fd, O_CLOEXEC);
+  ::close(the_new);
+}
+
+static void
+__after_fork_child() noexcept
+{
+  // The descriptors are shared with the parent: its dispatcher would
+  // take the wake-ups of this one and the other way round, and a new
+  // signalfd mask here would change its routed signals too. The queue
+  // is copied, the new counter wakes its first dispatch()
+  if (_s_event >= 0)
+  {
+    __replace(
+      _s_event,
+      ::eventfd(
+        (controller::mode::queue == _s_mode.load() ? 1 : 0),
+        EFD_NONBLOCK | EFD_CLOEXEC));
+  }
+
+  if (_s_fd >= 0)
+    __replace(_s_fd, ::signalfd(-1, &_s_routed, SFD_NONBLOCK | SFD_CLOEXEC));
+
+  _s_writer.unlock();
+
+  // The thread object names a thread of the parent: forget it
+  if (_s_is_orphaned)
+    new (&_s_dispatcher) std::thread();
+
+  if (_s_is_restarted)
+    __restart_dispatcher();
+}
+
+static void
+__open_event()
+{
+  if (_s_event >= 0)
+    return;
+
+  _s_event = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if (_s_event < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "eventfd() failed");
+  }
+}
+
+static void
+__wrong_signal(
+    const int the_id)
+{
+  std::error_code ec(errno, std::system_category());
+
+  std::string msg("Wrong signal ");
+  msg.append(std::to_string(the_id));
+
+  throw std::system_error(ec, msg);
+}
+
+// Install the callback, the former action goes to the handler
+static void
+__install(
+    const int the_id)
+{
+  struct sigaction sa;
+  sigemptyset(&sa.sa_mask);
+
+  // Fill the set
+  for (auto i = 0; i < controller::count; ++i)
   {
-    _s_handler[the_id]->process(the_id, the_info, the_context);
-    _s_stat[the_id].call_count++;
+    if (_s_handler[i].load() != nullptr &&
+        sigaddset(&sa.sa_mask, i))
+      __wrong_signal(i);
+  }
+
+  handler* __handler = _s_handler[the_id].load();
+
+  // Append
+  sa.sa_flags = SA_SIGINFO | __handler->flags();
+  sa.sa_sigaction = &__signal_callback;
+
+  // Set action
+  if (sigaction(the_id, &sa, __handler->get_handle()))
+  {
+    std::error_code ec(errno, std::system_category());
+    std::string msg("Unable to set up signal handler for ");
+    msg.append(std::to_string(the_id));
+    throw std::system_error(ec, msg);
+  }
+}
+
+// Signals read from the descriptor
+static bool
+__is_routed(
+    const controller::mode the_mode) noexcept
+{
+  return (controller::mode::descriptor == the_mode ||
+          controller::mode::thread     == the_mode);
+}
+
+// Block the signal and add it to the descriptor, or take it back
+static void
+__route(
+    const int  the_id,
+    const bool is_routed)
+{
+  sigset_t __one;
+  sigemptyset(&__one);
+
+  if (sigaddset(&__one, the_id))
+    __wrong_signal(the_id);
+
+  if (is_routed)
+  {
+    sigaddset(&_s_routed, the_id);
+
+    const int __error = ::pthread_sigmask(SIG_BLOCK, &__one, nullptr);
+
+    if (__error || ::signalfd(_s_fd, &_s_routed, 0) < 0)
+    {
+      std::error_code ec((__error ? __error : errno), std::system_category());
+      sigdelset(&_s_routed, the_id);
+
+      std::string msg("Unable to route signal ");
+      msg.append(std::to_string(the_id));
+      throw std::system_error(ec, msg);
+    }
   }
   else
-    _s_stat[the_id].error_count++;
+  {
+    sigdelset(&_s_routed, the_id);
+
+    ::signalfd(_s_fd, &_s_routed, 0);
+    ::pthread_sigmask(SIG_UNBLOCK, &__one, nullptr);
+  }
+}
+
+// signalfd record to siginfo as the handlers expect it
+static void
+__to_siginfo(
+    const struct signalfd_siginfo& the_record,
+    siginfo_t&                     the_info) noexcept
+{
+  std::memset(&the_info, 0, sizeof(the_info));
+
+  the_info.si_signo = the_record.ssi_signo;
+  the_info.si_errno = the_record.ssi_errno;
+  the_info.si_code  = the_record.ssi_code;
+  the_info.si_pid   = the_record.ssi_pid;
+  the_info.si_uid   = the_record.ssi_uid;
+
+  if (SIGCHLD == static_cast<int>(the_record.ssi_signo))
+  {
+    the_info.si_status = the_record.ssi_status;
+  }
+  else if (SIGSEGV == static_cast<int>(the_record.ssi_signo) ||
+           SIGBUS  == static_cast<int>(the_record.ssi_signo) ||
+           SIGILL  == static_cast<int>(the_record.ssi_signo) ||
+           SIGFPE  == static_cast<int>(the_record.ssi_signo))
+  {
+    the_info.si_addr = reinterpret_cast<void*>(the_record.ssi_addr);
+  }
+  else
+  {
+    the_info.si_value.sival_ptr = reinterpret_cast<void*>(the_record.ssi_ptr);
+  }
 }
 
 // Controller
 controller::controller() noexcept
 {
   for (auto i = 0; i < count; ++i)
-    _s_handler[i] = nullptr;
+    _s_handler[i].store(nullptr);
+
+  sigemptyset(&_s_routed);
+
+  for (std::size_t i = 0; i < queue_size; ++i)
+    _s_ring[i].sequence.store(i, std::memory_order_relaxed);
+
+  ::pthread_atfork(&__before_fork, &__after_fork_parent, &__after_fork_child);
 }
 
 controller::~controller() noexcept
 {
+  stop_dispatcher();
+
   for (auto i = 0; i < count; ++i)
     disable(i);
+
+  // Last readers
+  std::lock_guard<std::mutex> __lock(_s_writer);
+
+  while (!_s_retired.empty())
+  {
+    __reclaim();
+
+    if (!_s_retired.empty())
+      std::this_thread::yield();
+  }
+
+  for (int* fd : { &_s_fd, &_s_event })
+  {
+    if (*fd >= 0)
+    {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
 }
 
 controller&
@@ -138,13 +674,25 @@ controller::__lock(
           "Failed to call sigfillset");
   }
 
-  // Append
-  if (sigprocmask(__action, &mask, nullptr))
+  // Routed signals stay blocked
+  if (!is_lock_required)
+  {
+    for (auto i = 1; i < count; ++i)
+    {
+      if (sigismember(&_s_routed, i) == 1)
+        sigdelset(&mask, i);
+    }
+  }
+
+  // Append, the calling thread only
+  const int __error = ::pthread_sigmask(__action, &mask, nullptr);
+
+  if (__error)
   {
     throw std::system_error(
-          errno,
+          __error,
           std::system_category(),
-          "Failed to call sigprocmask for all signals");
+          "Failed to call pthread_sigmask for all signals");
   }
 }
 
@@ -155,22 +703,17 @@ controller::__lock(
 {
   if (the_id < count)
   {
+      // Routed signals stay blocked
+      if (!is_lock_required && sigismember(&_s_routed, the_id) == 1)
+        return;
+
       // Set action
       const int __action = (is_lock_required ? SIG_BLOCK : SIG_UNBLOCK);
 
-      // Fetch current mask
+      // Only this signal: the current mask would unblock all the
+      // blocked ones, the routed included
       sigset_t mask;
-
-      // Get mask
-      if (sigprocmask(__action, nullptr, &mask))
-      {
-        std::error_code ec(errno, std::system_category());
-
-        std::string msg("Failed to call sigprocmask for signal ");
-        msg.append(std::to_string(the_id));
-
-        throw std::system_error(ec, msg);
-      }
+      sigemptyset(&mask);
 
       // Append
       if (sigaddset(&mask, the_id))
@@ -183,12 +726,14 @@ controller::__lock(
         throw std::system_error(ec, msg);
       }
 
-      // Append
-      if (sigprocmask(__action, &mask, nullptr))
+      // Append, the calling thread only
+      const int __error = ::pthread_sigmask(__action, &mask, nullptr);
+
+      if (__error)
       {
-        std::error_code ec(errno, std::system_category());
+        std::error_code ec(__error, std::system_category());
 
-        std::string msg("Failed to call sigprocmask for signal ");
+        std::string msg("Failed to call pthread_sigmask for signal ");
         msg.append(std::to_string(the_id));
 
         throw std::system_error(ec, msg);
@@ -264,66 +809,389 @@ controller::enable(
     throw std::system_error(ec, msg);
   }
 
-  // Clean up
-  if (_s_handler[id] != nullptr)
+  std::lock_guard<std::mutex> __lock(_s_writer);
+
+  // Swap, the signals being processed keep the former handler
+  handler* __former = _s_handler[id].exchange(the_handle);
+
+  if (__former != nullptr)
+  {
+    // The action to restore is the one before the first handler
+    if (!__is_routed(_s_mode.load()))
+      __install(id);
+
+    *the_handle->get_handle() = *__former->get_handle();
+
+    __retire(__former);
+  }
+  else if (__is_routed(_s_mode.load()))
+  {
+    // Keep the action to restore
+    ::sigaction(id, nullptr, the_handle->get_handle());
+    __route(id, true);
+  }
+  else
+    __install(id);
+}
+
+void
+controller::disable(
+    const int id) noexcept
+{
+  if (id <= 0 || id >= count)
+    return;
+
+  std::lock_guard<std::mutex> __lock(_s_writer);
+
+  handler* __former = _s_handler[id].exchange(nullptr);
+
+  if (__former == nullptr)
+    return;
+
+  if (__is_routed(_s_mode.load()))
   {
-    delete _s_handler[id];
-    _s_handler[id] =  nullptr;
+    try
+    {
+      __route(id, false);
+    }
+    catch (const std::system_error&)
+    {
+      // Not routed
+    }
   }
+  else
+    ::sigaction(id, __former->get_handle(), nullptr);
 
-  // Move to handler
-  _s_handler[id] = std::move(the_handle);
+  __retire(__former);
+}
 
-  // Fetch current mask
-  struct sigaction sa;
-  sigemptyset(&sa.sa_mask);
+void
+controller::set_mode(
+    mode the_mode)
+{
+  const mode __former = _s_mode.load();
 
-  // Fill the set
-  for (auto i = 0; i < count; ++i)
+  if (the_mode == __former)
+    return;
+
+  const bool __was_routed = __is_routed(__former);
+  const bool __is_routing = __is_routed(the_mode);
+
+  // New descriptors first, nothing changes on failure
+  int __fd = -1;
+
+  if (__is_routing && !__was_routed)
   {
-    if (_s_handler[i] != nullptr &&
-        sigaddset(&sa.sa_mask, i))
+    __fd = ::signalfd(-1, &_s_routed, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (__fd < 0)
     {
-      std::error_code ec(errno, std::system_category());
+      throw std::system_error(errno, std::system_category(), "signalfd() failed");
+    }
+  }
+  else if (mode::queue == the_mode)
+    __open_event();
 
-      std::string msg("Wrong signal ");
-      msg.append(std::to_string(i));
+  // The dispatcher follows the descriptors, the own one of the thread
+  // mode only lives with it
+  const bool __is_dispatching = (_s_dispatcher.joinable() &&
+                                 mode::thread != __former);
+  stop_dispatcher();
 
-      throw std::system_error(ec, msg);
+  std::unique_lock<std::mutex> __lock(_s_writer);
+
+  // Signals back to the actions
+  if (__was_routed && !__is_routing)
+  {
+    for (auto i = 1; i < count; ++i)
+    {
+      if (_s_handler[i].load() == nullptr)
+        continue;
+
+      __install(i);
+      __route(i, false);
     }
+
+    ::close(_s_fd);
+    _s_fd = -1;
   }
 
-  // Append
-  sa.sa_flags = SA_SIGINFO | _s_handler[id]->flags();
-  sa.sa_sigaction = &__signal_callback;
+  if (__fd >= 0)
+    _s_fd = __fd;
 
-  // Set action
-  if (sigaction(id, &sa, _s_handler[id]->get_handle()))
+  _s_mode.store(the_mode, std::memory_order_release);
+
+  // Former actions back, signals to the descriptor
+  if (__is_routing && !__was_routed)
   {
-    std::error_code ec(errno, std::system_category());
-    std::string msg("Unable to set up signal handler for ");
-    msg.append(std::to_string(id));
-    throw std::system_error(ec, msg);
+    for (auto i = 1; i < count; ++i)
+    {
+      handler* __handler = _s_handler[i].load();
+
+      if (__handler == nullptr)
+        continue;
+
+      ::sigaction(i, __handler->get_handle(), nullptr);
+      __route(i, true);
+    }
+  }
+
+  __lock.unlock();
+
+  // Queued before the switch: nothing dispatches in action mode. The
+  // dispatcher is stopped, so this thread is the only consumer
+  if (mode::queue == __former)
+    __drain();
+
+  if (__is_dispatching || mode::thread == the_mode)
+    start_dispatcher();
+}
+
+controller::mode
+controller::get_mode() const noexcept
+{
+  return _s_mode.load();
+}
+
+int
+controller::get_descriptor() const noexcept
+{
+  switch (_s_mode.load())
+  {
+  case mode::descriptor:  return _s_fd;
+  case mode::queue:       return _s_event;
+  default:                return -1;
+  }
+}
+
+std::vector<int>
+controller::get_descriptors() const
+{
+  std::vector<int> __result;
+
+  for (const int fd : { _s_fd, _s_event })
+  {
+    if (fd >= 0)
+      __result.push_back(fd);
+  }
+
+  return __result;
+}
+
+bool
+controller::is_routed(
+    const int the_id) const noexcept
+{
+  if (the_id <= 0 || the_id >= count)
+    return false;
+
+  return (__is_routed(_s_mode.load()) &&
+          _s_handler[the_id].load() != nullptr);
+}
+
+std::size_t
+controller::dispatch(
+    const int the_timeout)
+{
+  const bool __is_reading = __is_routed(_s_mode.load());
+
+  struct pollfd __poll[2];
+  nfds_t __count = 0;
+
+  if (__is_reading && _s_fd >= 0)
+  {
+    __poll[__count].fd     = _s_fd;
+    __poll[__count].events = POLLIN;
+    ++__count;
+  }
+
+  if (_s_event >= 0)
+  {
+    __poll[__count].fd     = _s_event;
+    __poll[__count].events = POLLIN;
+    ++__count;
+  }
+
+  if (!__count)
+    return __drain();
+
+  if (the_timeout && ::poll(__poll, __count, the_timeout) < 0 && EINTR != errno)
+  {
+    throw std::system_error(errno, std::system_category(), "poll() failed");
+  }
+
+  // Reset the wake counter before draining, a later push wakes again
+  if (_s_event >= 0)
+  {
+    std::uint64_t __value = 0;
+    if (0 > ::read(_s_event, &__value, sizeof(__value)))
+    {
+      // Nothing pending
+    }
+  }
+
+  std::size_t __total = __drain();
+
+  // Read in batches until empty
+  while (__is_reading && _s_fd >= 0)
+  {
+    struct signalfd_siginfo __batch[16];
+    const ssize_t __size = ::read(_s_fd, __batch, sizeof(__batch));
+
+    if (__size < 0)
+    {
+      if (EAGAIN == errno || EINTR == errno)
+        break;
+
+      throw std::system_error(errno, std::system_category(), "signalfd read() failed");
+    }
+
+    const std::size_t __records = __size / sizeof(__batch[0]);
+
+    for (std::size_t i = 0; i < __records; ++i)
+    {
+      const int __id = static_cast<int>(__batch[i].ssi_signo);
+
+      if (__id <= 0 || __id >= count)
+        continue;
+
+      siginfo_t __info;
+      __to_siginfo(__batch[i], __info);
+
+      // No send time in the record: no latency
+      __deliver(__id, &__info, nullptr);
+    }
+
+    __total += __records;
+
+    if (__records < sizeof(__batch) / sizeof(__batch[0]))
+      break;
+  }
+
+  // Handlers swapped meanwhile, if no writer is busy
+  std::unique_lock<std::mutex> __lock(_s_writer, std::try_to_lock);
+
+  if (__lock.owns_lock())
+    __reclaim();
+
+  return __total;
+}
+
+void
+controller::block_thread() const
+{
+  sigset_t __set;
+  sigemptyset(&__set);
+
+  for (auto i = 1; i < count; ++i)
+  {
+    if (_s_handler[i].load() != nullptr)
+      sigaddset(&__set, i);
+  }
+
+  const int __error = ::pthread_sigmask(SIG_BLOCK, &__set, nullptr);
+
+  if (__error)
+  {
+    throw std::system_error(
+          __error,
+          std::system_category(),
+          "Failed to call pthread_sigmask for the managed signals");
   }
 }
 
 void
-controller::disable(
-    const int id) noexcept
+controller::start_dispatcher()
 {
-  if (_s_handler[id] == nullptr)
+  if (_s_dispatcher.joinable())
     return;
 
-  ::sigaction(id, _s_handler[id]->get_handle(), nullptr);
+  // Wakes the thread to stop
+  __open_event();
+
+  _s_is_stopping.store(false);
 
-  delete _s_handler[id];
-  _s_handler[id] = nullptr;
+  _s_dispatcher = start_thread([this]()
+  {
+    while (!_s_is_stopping.load(std::memory_order_acquire))
+    {
+      try
+      {
+        dispatch(-1);
+      }
+      catch (const std::system_error&)
+      {
+        break;
+      }
+    }
+  });
 }
 
-const stat&
-controller::get_stat(const int the_id) noexcept
+void
+controller::stop_dispatcher() noexcept
 {
-  return _s_stat[the_id];
+  if (!_s_dispatcher.joinable())
+    return;
+
+  _s_is_stopping.store(true, std::memory_order_release);
+
+  const std::uint64_t __one = 1;
+  if (0 > ::write(_s_event, &__one, sizeof(__one)))
+  {
+    // Counter overflow only
+  }
+
+  _s_dispatcher.join();
+}
+
+stat
+controller::get_stat(const int the_id) const noexcept
+{
+  const counter& c = _s_stat[the_id];
+  stat __result;
+
+  __result.call_count     = c.call_count.load(std::memory_order_acquire);
+  __result.error_count    = c.error_count.load(std::memory_order_relaxed);
+  __result.overflow_count = c.overflow_count.load(std::memory_order_relaxed);
+  __result.last_delivery  = c.last_delivery.load(std::memory_order_relaxed);
+
+  for (std::size_t i = 0; i < stat::histogram_size; ++i)
+  {
+    __result.handler_time[i] = c.handler_time[i].load(std::memory_order_relaxed);
+    __result.latency[i]      = c.latency[i].load(std::memory_order_relaxed);
+  }
+
+  return __result;
+}
+
+std::vector<stat>
+controller::snapshot() const
+{
+  std::vector<stat> __result(count);
+
+  for (int __attempt = 0; __attempt < 4; ++__attempt)
+  {
+    for (auto i = 0; i < count; ++i)
+      __result[i] = get_stat(i);
+
+    // Stable if no delivery completed, failed or overflowed meanwhile
+    bool __is_stable = true;
+
+    for (auto i = 0; i < count && __is_stable; ++i)
+    {
+      const counter& c = _s_stat[i];
+
+      __is_stable =
+          __result[i].call_count     == c.call_count.load(std::memory_order_acquire) &&
+          __result[i].error_count    == c.error_count.load(std::memory_order_relaxed) &&
+          __result[i].overflow_count == c.overflow_count.load(std::memory_order_relaxed);
+    }
+
+    if (__is_stable)
+      break;
+  }
+
+  return __result;
 }
 
 } // End of egg::signal namespace
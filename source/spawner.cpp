@@ -0,0 +1,91 @@
+/*!
+ *	\file		spawner.cpp
+ *	\brief		Implements fork with process descriptor and fork inheritance of memory
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/mman.h>
+
+#include <unistd.h>
+
+#include <cerrno>
+
+#include "common.h"
+
+#include <egg/runner/descriptor.hpp>
+#include <egg/runner/spawner.hpp>
+
+
+namespace egg
+{
+
+pid_t
+spawner::spawn(
+    int* the_pidfd)
+{
+  if (the_pidfd)
+    *the_pidfd = -1;
+
+  const pid_t __pid = ::fork();
+
+  if (__pid < 0)
+  {
+    throw std::system_error(errno, std::system_category(), "fork() failed");
+  }
+
+  // The child is not reaped yet, its PID can not be reused
+  if (__pid > 0 && the_pidfd)
+    *the_pidfd = descriptor::pidfd_open(__pid);
+
+  return __pid;
+}
+
+void
+spawner::set_inheritance(
+    void*             the_address,
+    const std::size_t the_size,
+    const inheritance the_inheritance)
+{
+  int __advice = MADV_DOFORK;
+
+  if (inheritance::none == the_inheritance)
+  {
+    __advice = MADV_DONTFORK;
+  }
+  else if (inheritance::wipe == the_inheritance)
+  {
+#if HAVE_MADV_WIPEONFORK
+    __advice = MADV_WIPEONFORK;
+#else
+    throw std::system_error(
+      std::make_error_code(std::errc::function_not_supported),
+      "MADV_WIPEONFORK not supported");
+#endif
+  }
+
+  if (::madvise(the_address, the_size, __advice))
+  {
+    throw std::system_error(errno, std::system_category(), "madvise() failed");
+  }
+
+#if HAVE_MADV_WIPEONFORK
+
+  // Back to copy: drop the wipe too, anonymous private mappings only
+  if (inheritance::copy == the_inheritance)
+    ::madvise(the_address, the_size, MADV_KEEPONFORK);
+
+  // Wiped regions are still to be inherited
+  if (inheritance::wipe == the_inheritance)
+    ::madvise(the_address, the_size, MADV_DOFORK);
+
+#endif
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -0,0 +1,371 @@
+/*!
+ *	\file		supervisor.cpp
+ *	\brief		Implements supervisor mode: pidfd/epoll driven respawn
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#include <signal.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "common.h"
+
+#include <egg/runner/descriptor.hpp>
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Supervisor descriptors, closed in the child
+struct EGG_PRIVATE watch
+{
+
+watch() noexcept
+  :	_epoll(-1),
+	_signal(-1),
+	_child(-1)
+{
+}
+
+~watch() noexcept
+{
+  close_all();
+}
+
+void close_all() noexcept
+{
+  for (int* fd : { &_epoll, &_signal, &_child })
+  {
+    if (*fd >= 0)
+    {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+}
+
+int _epoll;
+int _signal;
+int _child;
+
+};
+
+static std::chrono::nanoseconds
+since(
+    const std::chrono::steady_clock::time_point the_point) noexcept
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - the_point);
+}
+
+} // End of egg::helper namespace
+
+// Implementation
+bool
+process::__supervise()
+{
+  using clock = std::chrono::steady_clock;
+
+  // The stop requests are read here: a routed handler would take them
+  // from the signalfd of the controller first
+  const signal::controller& __controller = signal::controller::instance();
+
+  if (__controller.is_routed(SIGTERM) || __controller.is_routed(SIGINT))
+  {
+    throw std::system_error(
+      std::make_error_code(std::errc::operation_not_permitted),
+      "Supervisor with SIGTERM or SIGINT routed by the signal controller");
+  }
+
+  helper::watch __watch;
+
+  // Stop requests and, without pidfd, SIGCHLD go through the signalfd
+  const bool __has_pidfd = descriptor::has_pidfd();
+
+  sigset_t __set;
+  sigset_t __saved;
+  ::sigemptyset(&__set);
+  ::sigaddset(&__set, SIGTERM);
+  ::sigaddset(&__set, SIGINT);
+
+  if (!__has_pidfd)
+    ::sigaddset(&__set, SIGCHLD);
+
+  const int __error = ::pthread_sigmask(SIG_BLOCK, &__set, &__saved);
+
+  if (__error)
+  {
+    throw std::system_error(__error, std::system_category(), "pthread_sigmask() failed");
+  }
+
+  __watch._signal = ::signalfd(-1, &__set, SFD_CLOEXEC | SFD_NONBLOCK);
+  __watch._epoll  = ::epoll_create1(EPOLL_CLOEXEC);
+
+  if (__watch._signal < 0 || __watch._epoll < 0)
+  {
+    std::error_code ec(errno, std::system_category());
+    ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+    throw std::system_error(ec, "Supervisor set-up failed");
+  }
+
+  struct epoll_event __event;
+  __event.events  = EPOLLIN;
+  __event.data.fd = __watch._signal;
+  ::epoll_ctl(__watch._epoll, EPOLL_CTL_ADD, __watch._signal, &__event);
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(
+        LOG_INFO,
+        "Supervising with %s ...",
+        __has_pidfd ? "pidfd" : "SIGCHLD");
+  }
+
+  _restart_stat = restart_stat();
+
+  bool              __is_stopping = false;
+  clock::time_point __exited;
+
+  for (;;)
+  {
+    // Spawn
+    const clock::time_point __started = clock::now();
+
+    if (_restart_stat.restarts || _restart_stat.crashes)
+    {
+      _restart_stat.last_latency = helper::since(__exited);
+      _restart_stat.max_latency  = std::max(
+          _restart_stat.max_latency,
+          _restart_stat.last_latency);
+    }
+
+    pid_t __pid = -1;
+
+    try
+    {
+      __pid = spawner::spawn((__has_pidfd ? &__watch._child : nullptr));
+    }
+    catch (const std::system_error&)
+    {
+      ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+      throw;
+    }
+
+    if (0 == __pid)
+    {
+      // Child: own signals, no supervisor descriptors
+      __watch.close_all();
+      ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+      __f_is_supervised = 1;
+
+      return false;
+    }
+
+    // The first child reports readiness
+    __close_ready();
+
+    if (__f_req_syslog && __f_trace && _restart_stat.restarts)
+    {
+      ::syslog(
+          LOG_INFO,
+          "Child %d respawned in %lld us",
+          __pid,
+          static_cast<long long>(_restart_stat.last_latency.count() / 1000));
+    }
+
+    if (__has_pidfd)
+    {
+      if (__watch._child < 0)
+      {
+        std::error_code ec(errno, std::system_category());
+        ::kill(__pid, SIGKILL);
+        ::waitpid(__pid, nullptr, 0);
+        ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+        throw std::system_error(ec, "Child process descriptor failed");
+      }
+
+      __event.events  = EPOLLIN;
+      __event.data.fd = __watch._child;
+      ::epoll_ctl(__watch._epoll, EPOLL_CTL_ADD, __watch._child, &__event);
+    }
+
+    // Watch until the child exits
+    int __status = 0;
+
+    for (bool __is_alive = true; __is_alive;)
+    {
+      struct epoll_event __ready[2];
+      const int __count = ::epoll_wait(__watch._epoll, __ready, 2, -1);
+
+      if (__count < 0)
+      {
+        if (EINTR == errno)
+          continue;
+
+        std::error_code ec(errno, std::system_category());
+        ::kill(__pid, SIGKILL);
+        ::waitpid(__pid, nullptr, 0);
+        ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+        throw std::system_error(ec, "epoll_wait() failed");
+      }
+
+      for (int i = 0; i < __count; ++i)
+      {
+        if (__ready[i].data.fd != __watch._signal)
+          continue;
+
+        struct signalfd_siginfo __info;
+        while (sizeof(__info) == ::read(__watch._signal, &__info, sizeof(__info)))
+        {
+          if (SIGTERM == __info.ssi_signo || SIGINT == __info.ssi_signo)
+          {
+            __is_stopping = true;
+            ::kill(__pid, __info.ssi_signo);
+          }
+        }
+      }
+
+      // Readable pidfd or SIGCHLD: reap without blocking
+      const pid_t __reaped = ::waitpid(__pid, &__status, WNOHANG);
+
+      if (__reaped == __pid || (__reaped < 0 && ECHILD == errno))
+        __is_alive = false;
+    }
+
+    __exited = clock::now();
+
+    if (__watch._child >= 0)
+    {
+      ::close(__watch._child);
+      __watch._child = -1;
+    }
+
+    const bool __is_abnormal =
+        WIFSIGNALED(__status) ||
+        (WIFEXITED(__status) && WEXITSTATUS(__status) != 0);
+
+    if (!__is_abnormal || __is_stopping)
+    {
+      if (__f_req_syslog && __f_trace)
+      {
+        ::syslog(LOG_INFO, "Child %d complete with status 0x%x", __pid, __status);
+      }
+
+      break;
+    }
+
+    // Crash loop detection: a long living child starts it over
+    if (__exited - __started >= _supervision.window)
+      _restart_stat.crashes = 0;
+
+    ++_restart_stat.crashes;
+
+    if (_supervision.crash_limit &&
+        _restart_stat.crashes >= _supervision.crash_limit)
+    {
+      _restart_stat.is_crash_loop = true;
+
+      if (__f_req_syslog)
+      {
+        ::syslog(
+            LOG_CRIT,
+            "Child %d failed %zu times in a row. Giving up",
+            __pid,
+            _restart_stat.crashes);
+      }
+
+      break;
+    }
+
+    const std::chrono::milliseconds __delay = __backoff(_restart_stat.crashes);
+
+    if (__f_req_syslog)
+    {
+      ::syslog(
+          LOG_WARNING,
+          "Child %d failed with status 0x%x. Respawning in %lld ms ...",
+          __pid,
+          __status,
+          static_cast<long long>(__delay.count()));
+    }
+
+    // Interruptible delay
+    const clock::time_point __deadline = __exited + __delay;
+
+    for (clock::time_point __now = clock::now();
+                           __now < __deadline && !__is_stopping;
+                           __now = clock::now())
+    {
+      const auto __left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          __deadline - __now).count() + 1;
+
+      struct epoll_event __ready;
+      if (::epoll_wait(__watch._epoll, &__ready, 1, static_cast<int>(__left)) <= 0)
+        continue;
+
+      struct signalfd_siginfo __info;
+      while (sizeof(__info) == ::read(__watch._signal, &__info, sizeof(__info)))
+      {
+        if (SIGTERM == __info.ssi_signo || SIGINT == __info.ssi_signo)
+          __is_stopping = true;
+      }
+    }
+
+    if (__is_stopping)
+      break;
+
+    ++_restart_stat.restarts;
+  }
+
+  ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(
+        LOG_INFO,
+        "Supervision complete: %zu restarts, max latency %lld us",
+        _restart_stat.restarts,
+        static_cast<long long>(_restart_stat.max_latency.count() / 1000));
+  }
+
+  return true;
+}
+
+std::chrono::milliseconds
+process::__backoff(
+    const std::size_t the_crashes) const noexcept
+{
+  // Exponential backoff
+  auto __delay = _supervision.initial_delay;
+  for (std::size_t i = 1;
+                   i < the_crashes && __delay < _supervision.maximum_delay;
+                 ++i)
+    __delay *= 2;
+
+  return std::min(__delay, _supervision.maximum_delay);
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -0,0 +1,443 @@
+/*!
+ *	\file		worker.cpp
+ *	\brief		Implements pre-fork worker pool
+ *	\author		Vladislav "Tanuki" Mikhailikov \<vmikhailikov\@gmail.com\>
+ *	\copyright	GNU GPL v3
+ *	\date		16/10/2026
+ *	\version	1.0
+ */
+
+// System
+#include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#include <sched.h>
+#include <signal.h>
+#include <syslog.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "common.h"
+
+#include <egg/runner/descriptor.hpp>
+#include <egg/runner/runner.hpp>
+
+
+namespace egg
+{
+
+// Helpers
+namespace helper
+{
+
+// Master descriptors and respawn state, closed in the workers
+struct EGG_PRIVATE pool
+{
+
+using clock = std::chrono::steady_clock;
+
+pool(
+    const std::size_t the_count) noexcept
+  :	_epoll(-1),
+	_signal(-1),
+	_child(the_count, -1),
+	_crashes(the_count, 0),
+	_started(the_count),
+	_respawn(the_count, clock::time_point::max())
+{
+}
+
+~pool() noexcept
+{
+  close_all();
+}
+
+void close_child(
+    const std::size_t the_index) noexcept
+{
+  if (_child[the_index] >= 0)
+  {
+    ::close(_child[the_index]);
+    _child[the_index] = -1;
+  }
+}
+
+void close_all() noexcept
+{
+  for (int* fd : { &_epoll, &_signal })
+  {
+    if (*fd >= 0)
+    {
+      ::close(*fd);
+      *fd = -1;
+    }
+  }
+
+  for (std::size_t i = 0; i < _child.size(); ++i)
+    close_child(i);
+}
+
+int _epoll;
+int _signal;
+
+// Per worker: process descriptor, consecutive crashes, fork time and
+// pending respawn (max if none)
+std::vector<int>               _child;
+std::vector<std::size_t>       _crashes;
+std::vector<clock::time_point> _started;
+std::vector<clock::time_point> _respawn;
+
+};
+
+} // End of egg::helper namespace
+
+// Implementation
+void
+process::__run_workers()
+{
+  using clock = std::chrono::steady_clock;
+
+  // The stop requests are read here: a routed handler would take them
+  // from the signalfd of the controller first
+  const signal::controller& __controller = signal::controller::instance();
+
+  if (__controller.is_routed(SIGTERM) || __controller.is_routed(SIGINT))
+  {
+    throw std::system_error(
+      std::make_error_code(std::errc::operation_not_permitted),
+      "Worker pool with SIGTERM or SIGINT routed by the signal controller");
+  }
+
+  const std::size_t __count = __count_workers();
+
+  _worker_pids.assign(__count, -1);
+
+  helper::pool __pool(__count);
+
+  // Stop requests and, without pidfd, SIGCHLD go through the signalfd:
+  // nothing is lost between the checks and the wait
+  const bool __has_pidfd = descriptor::has_pidfd();
+
+  sigset_t __set;
+  sigset_t __saved;
+  ::sigemptyset(&__set);
+  ::sigaddset(&__set, SIGTERM);
+  ::sigaddset(&__set, SIGINT);
+
+  if (!__has_pidfd)
+    ::sigaddset(&__set, SIGCHLD);
+
+  const int __error = ::pthread_sigmask(SIG_BLOCK, &__set, &__saved);
+
+  if (__error)
+  {
+    throw std::system_error(__error, std::system_category(), "pthread_sigmask() failed");
+  }
+
+  __pool._signal = ::signalfd(-1, &__set, SFD_CLOEXEC | SFD_NONBLOCK);
+  __pool._epoll  = ::epoll_create1(EPOLL_CLOEXEC);
+
+  if (__pool._signal < 0 || __pool._epoll < 0)
+  {
+    std::error_code ec(errno, std::system_category());
+    ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+    throw std::system_error(ec, "Worker pool set-up failed");
+  }
+
+  struct epoll_event __event;
+  __event.events   = EPOLLIN;
+  __event.data.u64 = __count;
+  ::epoll_ctl(__pool._epoll, EPOLL_CTL_ADD, __pool._signal, &__event);
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(
+        LOG_INFO,
+        "Starting %zu workers on %zu CPUs with %s ...",
+        __count,
+        _worker_cpus.size(),
+        __has_pidfd ? "pidfd" : "SIGCHLD");
+  }
+
+  // Fork one worker, returns in the master only
+  auto __spawn = [&](const std::size_t the_index)
+  {
+    int* __child = (__has_pidfd ? &__pool._child[the_index] : nullptr);
+
+    const pid_t __pid = spawner::spawn(__child);
+
+    if (0 == __pid)
+    {
+      // Worker: own signals, no master descriptors
+      __pool.close_all();
+      ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+      __run_worker(the_index);
+    }
+
+    _worker_pids[the_index]      = __pid;
+    __pool._started[the_index]   = clock::now();
+    __pool._respawn[the_index]   = clock::time_point::max();
+
+    if (__child)
+    {
+      if (*__child < 0)
+      {
+        throw std::system_error(errno, std::system_category(), "Worker process descriptor failed");
+      }
+
+      __event.events   = EPOLLIN;
+      __event.data.u64 = the_index;
+      ::epoll_ctl(__pool._epoll, EPOLL_CTL_ADD, *__child, &__event);
+    }
+  };
+
+  try
+  {
+    for (std::size_t i = 0; i < __count; ++i)
+      __spawn(i);
+
+    // Runner threads once the pool is forked: no worker starts as a
+    // copy of a multithreaded master
+    __serve_instance();
+    __start_watchdog();
+
+    // Supervise
+    bool __is_stopping = false;
+
+    for (;;)
+    {
+      // Live workers and the nearest respawn
+      bool              __is_busy = false;
+      clock::time_point __next    = clock::time_point::max();
+
+      for (std::size_t i = 0; i < __count; ++i)
+      {
+        if (_worker_pids[i] > 0 || __pool._respawn[i] != clock::time_point::max())
+          __is_busy = true;
+
+        __next = std::min(__next, __pool._respawn[i]);
+      }
+
+      if (!__is_busy)
+        break;
+
+      int __timeout = -1;
+
+      if (__next != clock::time_point::max())
+      {
+        const auto __left = std::chrono::duration_cast<std::chrono::milliseconds>(
+            __next - clock::now()).count() + 1;
+
+        __timeout = static_cast<int>(std::max<long long>(0, __left));
+      }
+
+      struct epoll_event __ready[8];
+      if (::epoll_wait(__pool._epoll, __ready, 8, __timeout) < 0 && EINTR != errno)
+      {
+        throw std::system_error(errno, std::system_category(), "epoll_wait() failed");
+      }
+
+      // Termination is forwarded to the workers
+      struct signalfd_siginfo __info;
+      while (sizeof(__info) == ::read(__pool._signal, &__info, sizeof(__info)))
+      {
+        if (SIGTERM != __info.ssi_signo && SIGINT != __info.ssi_signo)
+          continue;
+
+        __is_stopping = true;
+
+        for (std::size_t i = 0; i < __count; ++i)
+        {
+          __pool._respawn[i] = clock::time_point::max();
+
+          if (_worker_pids[i] > 0)
+            ::kill(_worker_pids[i], __info.ssi_signo);
+        }
+      }
+
+      // Readable pidfd or SIGCHLD: reap without blocking
+      for (;;)
+      {
+        int __status = 0;
+        const pid_t __pid = ::waitpid(-1, &__status, WNOHANG);
+
+        if (__pid <= 0)
+          break;
+
+        const auto __slot = std::find(_worker_pids.begin(), _worker_pids.end(), __pid);
+        if (__slot == _worker_pids.end())
+          continue;
+
+        const std::size_t       __index  = __slot - _worker_pids.begin();
+        const clock::time_point __exited = clock::now();
+
+        *__slot = -1;
+        __pool.close_child(__index);
+
+        const bool __is_abnormal =
+            WIFSIGNALED(__status) ||
+            (WIFEXITED(__status) && WEXITSTATUS(__status) != 0);
+
+        if (!__is_abnormal || __is_stopping)
+          continue;
+
+        // Crash loop detection: a long living worker starts it over
+        if (__exited - __pool._started[__index] >= _supervision.window)
+          __pool._crashes[__index] = 0;
+
+        const std::size_t __crashes = ++__pool._crashes[__index];
+
+        if (_supervision.crash_limit && __crashes >= _supervision.crash_limit)
+        {
+          if (__f_req_syslog)
+          {
+            ::syslog(
+                LOG_CRIT,
+                "Worker %zu (%d) failed %zu times in a row. Giving up",
+                __index,
+                __pid,
+                __crashes);
+          }
+
+          continue;
+        }
+
+        const std::chrono::milliseconds __delay = __backoff(__crashes);
+
+        if (__f_req_syslog)
+        {
+          ::syslog(
+              LOG_WARNING,
+              "Worker %zu (%d) failed with status 0x%x. Respawning in %lld ms ...",
+              __index,
+              __pid,
+              __status,
+              static_cast<long long>(__delay.count()));
+        }
+
+        __pool._respawn[__index] = __exited + __delay;
+      }
+
+      // Due respawns
+      const clock::time_point __now = clock::now();
+
+      for (std::size_t i = 0; i < __count; ++i)
+      {
+        if (__pool._respawn[i] <= __now)
+          __spawn(i);
+      }
+    }
+  }
+  catch (...)
+  {
+    // The pool goes down with the master
+    for (pid_t& pid : _worker_pids)
+    {
+      if (pid > 0)
+      {
+        ::kill(pid, SIGTERM);
+        ::waitpid(pid, nullptr, 0);
+        pid = -1;
+      }
+    }
+
+    ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+    throw;
+  }
+
+  ::pthread_sigmask(SIG_SETMASK, &__saved, nullptr);
+
+  if (__f_req_syslog && __f_trace)
+  {
+    ::syslog(LOG_INFO, "All workers complete");
+  }
+}
+
+std::size_t
+process::__count_workers()
+{
+  // CPUs of the affinity mask
+  cpu_set_t __cpus;
+  CPU_ZERO(&__cpus);
+
+  _worker_cpus.clear();
+
+  if (0 == ::sched_getaffinity(0, sizeof(__cpus), &__cpus))
+  {
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+    {
+      if (CPU_ISSET(i, &__cpus))
+        _worker_cpus.push_back(i);
+    }
+  }
+
+  return (_workers
+      ? _workers
+      : std::max<std::size_t>(1, _worker_cpus.size()));
+}
+
+void
+process::__run_worker(
+    const std::size_t the_index)
+{
+  // Worker: own CPU
+  _worker = static_cast<int>(the_index);
+  _worker_pids.clear();
+
+  if (!_worker_cpus.empty())
+  {
+    cpu_set_t __set;
+    CPU_ZERO(&__set);
+    CPU_SET(_worker_cpus[the_index % _worker_cpus.size()], &__set);
+
+    if (::sched_setaffinity(0, sizeof(__set), &__set) && __f_req_syslog)
+    {
+      ::syslog(LOG_WARNING, "Worker %zu: sched_setaffinity() failed", the_index);
+    }
+  }
+
+  __join_worker_cgroup(the_index);
+
+  int __result = 0;
+
+  try
+  {
+    // Locks are not inherited over fork()
+    __lock_memory();
+
+    run();
+  }
+  catch (const std::exception& e)
+  {
+    if (__f_req_syslog)
+    {
+      ::syslog(LOG_ERR, "Worker %zu: %s", the_index, e.what());
+    }
+
+    __result = 1;
+  }
+  catch (...)
+  {
+    // Nothing may unwind past the fork() of the master
+    if (__f_req_syslog)
+    {
+      ::syslog(LOG_ERR, "Worker %zu: unknown exception", the_index);
+    }
+
+    __result = 1;
+  }
+
+  // The master owns the PID file and the instance socket
+  ::fflush(nullptr);
+  ::_exit(__result);
+}
+
+} // End of egg namespace
+
+/* End of file */
@@ -0,0 +1,229 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <egg/runner/scanner.hpp>
+
+
+// The former process::exists() implementation kept as the baseline
+void
+exists(
+  const std::string&  root,
+  const std::string&  name,
+  std::list<pid_t>&   result)
+{
+  DIR* __process_dir = ::opendir(root.c_str());
+
+  if (!__process_dir)
+    throw std::system_error(
+      errno,
+      std::system_category(),
+      "Failed to open " + root);
+
+  char __buffer[512];
+  for (struct dirent* entry  = ::readdir(__process_dir);
+                      entry != NULL;
+		      entry  = ::readdir(__process_dir))
+  {
+    try
+    {
+      long __pid = std::stol(entry->d_name);
+
+      std::string __path(root);
+      __path.append("/");
+      __path.append(entry->d_name);
+      __path.append("/cmdline");
+
+      FILE* __file = ::fopen(__path.c_str(), "r");
+      if (__file != NULL &&
+         ::fgets(__buffer, 512, __file) != NULL)
+      {
+        std::string __cmd__line(__buffer);
+        if (__cmd__line.find(name) != std::string::npos)
+          result.push_back(__pid);
+      }
+      if (__file != NULL)
+        ::fclose(__file);
+    }
+    catch (const std::exception& e)
+    {
+      // Do nothing
+    }
+  }
+
+  ::closedir(__process_dir);
+}
+
+// Synthetic /proc: <pid>/cmdline and a few non-numeric entries
+void
+populate(
+  const std::string&  root,
+  const int           count,
+  const int           every)
+{
+  const char* __noise[] = { "self", "sys", "net", "version" };
+  for (auto n : __noise)
+    ::mkdir((root + "/" + n).c_str(), 0700);
+
+  for (int pid = 1; pid <= count; ++pid)
+  {
+    const std::string __dir(root + "/" + std::to_string(pid));
+    if (::mkdir(__dir.c_str(), 0700))
+      throw std::system_error(errno, std::system_category(), "mkdir " + __dir);
+
+    std::string __cmdline(
+        (pid % every) ? "/usr/sbin/worker-" + std::to_string(pid)
+                      : std::string("/usr/sbin/egg-target-daemon"));
+    __cmdline.push_back('\0');
+    __cmdline.append("--config=/etc/egg-target-daemon.conf");
+    __cmdline.push_back('\0');
+
+    const int fd = ::open(
+          (__dir + "/cmdline").c_str(),
+          O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+          0600);
+    if (fd < 0)
+      throw std::system_error(errno, std::system_category(), "open " + __dir);
+
+    if (::write(fd, __cmdline.data(), __cmdline.size()) < 0)
+      throw std::system_error(errno, std::system_category(), "write " + __dir);
+
+    ::close(fd);
+  }
+}
+
+void
+cleanup(
+  const std::string&  root,
+  const int           count)
+{
+  const char* __noise[] = { "self", "sys", "net", "version" };
+  for (auto n : __noise)
+    ::rmdir((root + "/" + n).c_str());
+
+  for (int pid = 1; pid <= count; ++pid)
+  {
+    const std::string __dir(root + "/" + std::to_string(pid));
+    ::unlink((__dir + "/cmdline").c_str());
+    ::rmdir(__dir.c_str());
+  }
+
+  ::rmdir(root.c_str());
+}
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::endl;
+  using std::cerr;
+  using clock = std::chrono::steady_clock;
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  const int __count   = (argc > 1 ? std::atoi(argv[1]) : 100000);
+  const int __every   = 1000;
+  const int __rounds  = 3;
+  int       __result  = 0;
+
+  char __template[] = "/tmp/egg-scanner-XXXXXX";
+  if (NULL == ::mkdtemp(__template))
+  {
+    cerr << "mkdtemp() failed" << endl;
+    return 1;
+  }
+
+  const std::string __root(__template);
+
+  cout << "Benchmarking /proc scanner on " << __count << " PIDs" << endl;
+  cout << "---------------------------------------------------------" << endl;
+  try
+  {
+    populate(__root, __count, __every);
+
+    long __legacy_us  = 0;
+    long __scanner_us = 0;
+    long __parallel_us = 0;
+
+    const unsigned __threads = std::max(2u, std::thread::hardware_concurrency());
+
+    for (int r = 0; r < __rounds; ++r)
+    {
+      std::list<pid_t> __legacy;
+      auto __start = clock::now();
+      exists(__root, "egg-target-daemon", __legacy);
+      __legacy_us += duration_cast<microseconds>(clock::now() - __start).count();
+
+      std::vector<pid_t> __found;
+      __start = clock::now();
+      egg::scanner __scanner(__root);
+      __scanner.find("egg-target-daemon", __found);
+      __scanner_us += duration_cast<microseconds>(clock::now() - __start).count();
+
+      std::vector<pid_t> __parallel;
+      __start = clock::now();
+      egg::scanner __sharded(__root);
+      __sharded.set_threads(__threads);
+      __sharded.set_threshold(0);  // Sharded on the small ctest tree too
+      __sharded.find("egg-target-daemon", __parallel);
+      __parallel_us += duration_cast<microseconds>(clock::now() - __start).count();
+
+      std::vector<pid_t> __expected(__legacy.begin(), __legacy.end());
+      std::sort(__expected.begin(), __expected.end());
+      std::sort(__found.begin(), __found.end());
+      std::sort(__parallel.begin(), __parallel.end());
+
+      if (__expected != __found ||
+          __expected != __parallel ||
+          __found.size() != static_cast<std::size_t>(__count / __every))
+      {
+        cerr << "Mismatch: legacy " << __expected.size()
+             << ", scanner " << __found.size()
+             << ", parallel " << __parallel.size() << endl;
+        __result = 1;
+      }
+    }
+
+    cout << "readdir/fopen/stol: " << __legacy_us / __rounds  << " us" << endl
+         << "getdents64/pread:   " << __scanner_us / __rounds << " us" << endl
+         << "Speedup:            "
+         << (__scanner_us ? double(__legacy_us) / __scanner_us : 0.0) << "x"
+         << endl
+         << __threads << " threads:          " << __parallel_us / __rounds << " us"
+         << endl
+         << "Speedup:            "
+         << (__parallel_us ? double(__legacy_us) / __parallel_us : 0.0) << "x"
+         << endl;
+
+    // Self check on the real /proc
+    egg::scanner __proc;
+    cout << "Self PID: " << __proc.find(argv[0])
+         << ", getpid(): " << getpid() << endl;
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+    __result = 1;
+  }
+
+  cleanup(__root, __count);
+
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return __result;
+}
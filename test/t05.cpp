@@ -0,0 +1,127 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <egg/runner/runner.hpp>
+
+
+namespace test
+{
+
+// Socket activated service: takes the "http" socket from the launcher
+struct daemon : public egg::process
+{
+
+daemon(
+    const std::string& argv0)
+  : egg::process(argv0),
+    accepted(false)
+{
+}
+
+void before()
+{
+  std::cout << "Call before(): http = " << get_listen_fd("http")
+            << ", unknown = " << get_listen_fd("unknown")
+            << ", total = " << get_listen_fds().size() << std::endl;
+}
+
+void between()
+{
+}
+
+void after()
+{
+}
+
+void run()
+{
+  const int fd = get_listen_fd("http");
+  if (fd < 0)
+    return;
+
+  // The connection queued by the launcher before we started
+  const int client = ::accept(fd, nullptr, nullptr);
+  if (client >= 0)
+  {
+    accepted = true;
+    ::close(client);
+  }
+
+  std::cout << "Call run(): accepted = " << accepted << std::endl;
+}
+
+bool accepted;
+
+};
+
+}
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::endl;
+  using std::cerr;
+
+  int result = 1;
+
+  cout << "Checking socket activation" << endl;
+  cout << "---------------------------------------------------------" << endl;
+  try
+  {
+    // Launcher stand-in: bind, listen and queue a client
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    address.sin_family      = AF_INET;
+    address.sin_port        = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (fd < 0 ||
+        ::bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) ||
+        ::listen(fd, 8) ||
+        ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&address), &length))
+      throw std::system_error(errno, std::system_category(), "Listener");
+
+    const int client = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(client, reinterpret_cast<struct sockaddr*>(&address), length))
+      throw std::system_error(errno, std::system_category(), "Client");
+
+    // Pass it as the first activated descriptor
+    if (fd != egg::process::listen_fds_start)
+    {
+      ::dup2(fd, egg::process::listen_fds_start);
+      ::close(fd);
+    }
+
+    ::setenv("LISTEN_PID",     std::to_string(getpid()).c_str(), 1);
+    ::setenv("LISTEN_FDS",     "1",    1);
+    ::setenv("LISTEN_FDNAMES", "http", 1);
+
+    test::daemon the_daemon(argv[0]);
+    the_daemon.execute();
+
+    result = (the_daemon.accepted &&
+              NULL == ::getenv("LISTEN_FDS") ? 0 : 1);
+
+    ::close(client);
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+  }
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return result;
+}
@@ -0,0 +1,181 @@
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <egg/runner/spawner.hpp>
+
+
+namespace test
+{
+
+using clock = std::chrono::steady_clock;
+
+// MemAvailable in bytes, 0 if unknown
+std::size_t
+available()
+{
+  FILE* f = ::fopen("/proc/meminfo", "r");
+  if (!f)
+    return 0;
+
+  char line[256];
+  unsigned long long kb = 0;
+
+  while (::fgets(line, sizeof(line), f))
+  {
+    if (1 == std::sscanf(line, "MemAvailable: %llu kB", &kb))
+      break;
+  }
+
+  ::fclose(f);
+
+  return kb * 1024;
+}
+
+// Median parent side latency of spawn() in microseconds
+long
+measure(
+  const int the_rounds)
+{
+  std::vector<long> samples;
+
+  for (int r = 0; r < the_rounds; ++r)
+  {
+    int pidfd = -1;
+
+    const auto start = clock::now();
+    const pid_t pid  = egg::spawner::spawn(&pidfd);
+
+    if (0 == pid)
+      ::_exit(0);
+
+    samples.push_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+          clock::now() - start).count());
+
+    ::waitpid(pid, nullptr, 0);
+
+    if (pidfd >= 0)
+      ::close(pidfd);
+  }
+
+  std::sort(samples.begin(), samples.end());
+
+  return samples[samples.size() / 2];
+}
+
+} // End of test namespace
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::cerr;
+  using std::endl;
+  using egg::spawner;
+
+  // Resident sizes in GiB
+  std::vector<std::size_t> sizes;
+  for (int i = 1; i < argc; ++i)
+    sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+
+  if (sizes.empty())
+    sizes = { 1, 4, 16 };
+
+  const int rounds = 5;
+  int       result = 0;
+
+  cout << "Benchmarking fork latency on large RSS" << endl;
+  cout << "---------------------------------------------------------" << endl;
+
+  for (const std::size_t gib : sizes)
+  {
+    const std::size_t size = gib << 30;
+
+    if (size > test::available() / 4 * 3)
+    {
+      cout << gib << " GiB: skipped, not enough memory" << endl;
+      continue;
+    }
+
+    void* region = ::mmap(
+          nullptr,
+          size,
+          PROT_READ | PROT_WRITE,
+          MAP_PRIVATE | MAP_ANONYMOUS,
+          -1,
+          0);
+
+    if (MAP_FAILED == region)
+    {
+      cout << gib << " GiB: skipped, mmap() failed" << endl;
+      continue;
+    }
+
+    try
+    {
+      // Small pages: the worst case for the page table copy
+      ::madvise(region, size, MADV_NOHUGEPAGE);
+
+      // Make it resident
+      for (std::size_t offset = 0; offset < size; offset += 4096)
+        static_cast<char*>(region)[offset] = 1;
+
+      const long fork_us = test::measure(rounds);
+
+      spawner::set_inheritance(region, size, spawner::inheritance::none);
+      const long none_us = test::measure(rounds);
+
+      long wipe_us = -1;
+      try
+      {
+        spawner::set_inheritance(region, size, spawner::inheritance::wipe);
+        wipe_us = test::measure(rounds);
+      }
+      catch (const std::system_error&)
+      {
+        // No MADV_WIPEONFORK
+      }
+
+      spawner::set_inheritance(region, size, spawner::inheritance::copy);
+      const long copy_us = test::measure(rounds);
+
+      cout << gib << " GiB: fork " << fork_us << " us"
+           << ", MADV_DONTFORK " << none_us << " us"
+           << ", MADV_WIPEONFORK " << wipe_us << " us"
+           << ", restored " << copy_us << " us" << endl;
+
+      // Excluded regions must not cost the copy
+      if (none_us > fork_us || (wipe_us >= 0 && wipe_us > fork_us))
+      {
+        cerr << "Excluded region is not faster" << endl;
+        result = 1;
+      }
+    }
+    catch (const std::exception& e)
+    {
+      cerr << e.what() << endl;
+      result = 1;
+    }
+
+    ::munmap(region, size);
+  }
+
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return result;
+}
@@ -0,0 +1,161 @@
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <egg/runner/runner.hpp>
+
+
+namespace test
+{
+
+// Kicks the watchdog for a while, then hangs
+struct daemon : public egg::process
+{
+
+daemon(
+    const std::string& argv0)
+  : egg::process(argv0)
+{
+  enable(property::notify);
+  enable(property::watchdog);
+}
+
+void before()
+{
+}
+
+void between()
+{
+}
+
+void after()
+{
+}
+
+void run()
+{
+  set_status("working");
+
+  for (int i = 0; i < 8; ++i)
+  {
+    kick();
+    ::usleep(50000);
+  }
+
+  set_status("hung");
+  ::usleep(400000);
+}
+
+};
+
+}
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::endl;
+  using std::cerr;
+
+  int result = 1;
+
+  cout << "Checking service manager notifications" << endl;
+  cout << "---------------------------------------------------------" << endl;
+  try
+  {
+    // Manager stand-in: abstract datagram socket
+    const std::string label("egg-notify-" + std::to_string(getpid()));
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path + 1, label.data(), label.size());
+
+    const int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        ::bind(
+          fd,
+          reinterpret_cast<struct sockaddr*>(&address),
+          offsetof(struct sockaddr_un, sun_path) + 1 + label.size()))
+      throw std::system_error(errno, std::system_category(), "Manager");
+
+    ::setenv("NOTIFY_SOCKET", ("@" + label).c_str(), 1);
+    ::setenv("WATCHDOG_USEC", "100000", 1);
+
+    // Collect while the daemon runs
+    std::vector<std::string> messages;
+    std::atomic<bool>        is_done(false);
+
+    std::thread manager([&]()
+      {
+        char buffer[256];
+        struct pollfd p = { fd, POLLIN, 0 };
+
+        while (!is_done || ::poll(&p, 1, 0) > 0)
+        {
+          if (::poll(&p, 1, 50) <= 0)
+            continue;
+
+          const ssize_t count = ::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+          if (count > 0)
+            messages.emplace_back(buffer, count);
+        }
+      });
+
+    test::daemon the_daemon(argv[0]);
+    the_daemon.execute();
+
+    is_done = true;
+    manager.join();
+
+    ::close(fd);
+
+    int  alive  = 0;
+    int  hung   = 0;
+    bool is_hung = false;
+    bool is_ready = false;
+    bool is_main  = false;
+    bool is_stopping = false;
+
+    for (const auto& m : messages)
+    {
+      cout << m << endl;
+
+      if ("READY=1" == m)
+        is_ready = true;
+      else if ("MAINPID=" + std::to_string(getpid()) == m)
+        is_main = true;
+      else if ("STOPPING=1" == m)
+        is_stopping = true;
+      else if ("STATUS=hung" == m)
+        is_hung = true;
+      else if ("WATCHDOG=1" == m)
+        ++(is_hung ? hung : alive);
+    }
+
+    cout << "Keepalives: " << alive << " while kicked, "
+         << hung << " while hung" << endl;
+
+    result = (is_ready && is_main && is_stopping &&
+              alive >= 3 && hung <= 1 ? 0 : 1);
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+  }
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return result;
+}
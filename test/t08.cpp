@@ -0,0 +1,139 @@
+#include <sys/types.h>
+#include <ftw.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <egg/runner/runner.hpp>
+
+
+namespace test
+{
+
+// Two workers, each in its own leaf cgroup
+struct daemon : public egg::process
+{
+
+daemon(
+    const std::string& argv0,
+    const std::string& root)
+  : egg::process(argv0)
+{
+  enable(property::cgroup);
+  set(property::cgroup_root, root);
+  set(property::cgroup, "egg/test");
+  set(property::cpu_max, "50000 100000");
+  set(property::cpu_weight, "200");
+  set(property::memory_max, "1073741824");
+
+  enable(property::workers);
+  enable(property::worker_cgroups);
+  set(property::workers, "2");
+}
+
+void before()
+{
+}
+
+void between()
+{
+}
+
+void after()
+{
+}
+
+void run()
+{
+}
+
+};
+
+std::string
+content(
+  const std::string& path)
+{
+  std::ifstream f(path);
+  std::stringstream s;
+  s << f.rdbuf();
+
+  return s.str();
+}
+
+int
+remove(
+  const char*         path,
+  const struct stat*  info,
+  int                 flag,
+  struct FTW*         ftw)
+{
+  return ::remove(path);
+}
+
+}
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::endl;
+  using std::cerr;
+
+  int result = 1;
+
+  char root[] = "/tmp/egg-cgroup-XXXXXX";
+  if (NULL == ::mkdtemp(root))
+  {
+    cerr << "mkdtemp() failed" << endl;
+    return 1;
+  }
+
+  cout << "Checking cgroup v2 placement on a stand-in root" << endl;
+  cout << "---------------------------------------------------------" << endl;
+  try
+  {
+    test::daemon the_daemon(argv[0], root);
+    the_daemon.execute();
+
+    const std::string target(std::string(root) + "/egg/test");
+
+    const std::string controllers = test::content(std::string(root) + "/cgroup.subtree_control");
+    const std::string inner       = test::content(std::string(root) + "/egg/cgroup.subtree_control");
+    const std::string cpu_max     = test::content(target + "/cpu.max");
+    const std::string memory_max  = test::content(target + "/memory.max");
+    const std::string procs       = test::content(target + "/cgroup.procs");
+    const std::string worker_0    = test::content(target + "/worker-0/cgroup.procs");
+    const std::string worker_1    = test::content(target + "/worker-1/cgroup.procs");
+
+    cout << "Controllers: " << controllers << endl
+         << "cpu.max:     " << cpu_max     << endl
+         << "memory.max:  " << memory_max  << endl
+         << "Master:      " << procs       << endl
+         << "Workers:     " << worker_0 << ", " << worker_1 << endl;
+
+    result = ("+cpu +memory" == controllers &&
+              controllers == inner &&
+              "50000 100000" == cpu_max &&
+              "1073741824" == memory_max &&
+              std::to_string(getpid()) == procs &&
+              !worker_0.empty() && !worker_1.empty() &&
+              worker_0 != worker_1 ? 0 : 1);
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+  }
+
+  ::nftw(root, test::remove, 16, FTW_DEPTH | FTW_PHYS);
+
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return result;
+}
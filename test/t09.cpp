@@ -0,0 +1,173 @@
+#include <sys/types.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <egg/runner/signal.hpp>
+
+
+namespace test
+{
+
+std::atomic<long> live(0);
+std::atomic<long> corrupt(0);
+
+// Detects a call on a deleted handler
+struct probe : public egg::signal::handler
+{
+
+enum
+{
+  alive = 0x0e66,
+  dead  = 0xdead
+};
+
+probe(
+    const int the_id) noexcept
+  : egg::signal::handler(the_id, SA_RESTART),
+    magic(alive)
+{
+  ++live;
+}
+
+virtual ~probe() noexcept
+{
+  magic = dead;
+  --live;
+}
+
+void process(int the_id) noexcept
+{}
+
+void process(
+	int         the_id,
+	siginfo_t*  the_info,
+	void*       the_context) noexcept
+{
+  if (alive != magic.load())
+    ++corrupt;
+
+  // Widen the window for a swap
+  for (volatile int i = 0; i < 64; ++i)
+    ;
+
+  if (alive != magic.load())
+    ++corrupt;
+}
+
+std::atomic<unsigned> magic;
+
+};
+
+}
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::endl;
+  using std::cerr;
+  using mode = egg::signal::controller::mode;
+
+  const int    __signals[] = { SIGUSR1, SIGUSR2, SIGRTMIN };
+  const int    __count     = (argc > 1 ? std::atoi(argv[1]) : 20000);
+  int          __result    = 0;
+
+  // Leftovers after disable() are ignored, not fatal
+  for (const int s : __signals)
+    ::signal(s, SIG_IGN);
+
+  egg::signal::controller& c = egg::signal::controller::instance();
+
+  cout << "Stressing handler swaps under signals" << endl;
+  cout << "---------------------------------------------------------" << endl;
+  try
+  {
+    for (const mode m : { mode::action, mode::queue, mode::descriptor, mode::thread })
+    {
+      c.set_mode(m);
+
+      unsigned long __before = 0;
+      for (const int s : __signals)
+      {
+        c.enable(new test::probe(s));
+        __before += c.get_stat(s).call_count;
+      }
+
+      if (mode::action != m)
+        c.start_dispatcher();
+
+      std::atomic<bool>          __is_running(true);
+      std::atomic<unsigned long> __swaps(0);
+      std::vector<std::thread>   __threads;
+
+      // Swapper
+      std::thread __swapper([&]()
+        {
+          for (unsigned long i = 0; __is_running; ++i)
+          {
+            c.enable(new test::probe(__signals[i % 3]));
+            ++__swaps;
+          }
+        });
+
+      // Senders
+      for (const int s : __signals)
+      {
+        __threads.emplace_back([&, s]()
+          {
+            for (int i = 0; i < __count; ++i)
+              ::kill(::getpid(), s);
+          });
+      }
+
+      for (auto& t : __threads)
+        t.join();
+
+      __is_running = false;
+      __swapper.join();
+
+      c.stop_dispatcher();
+      c.dispatch();
+
+      unsigned long __calls = 0;
+      for (const int s : __signals)
+      {
+        __calls += c.get_stat(s).call_count;
+        c.disable(s);
+      }
+
+      __calls -= __before;
+
+      const char* __name = (mode::action     == m ? "action" :
+                            mode::queue      == m ? "queue" :
+                            mode::descriptor == m ? "descriptor" : "thread");
+
+      cout << __name << ": " << __swaps << " swaps, " << __calls
+           << " calls, live handlers " << test::live
+           << ", corrupt calls " << test::corrupt << endl;
+
+      if (test::live || test::corrupt || !__swaps || !__calls)
+        __result = 1;
+    }
+
+    c.set_mode(mode::action);
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+    __result = 1;
+  }
+
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return __result;
+}
@@ -0,0 +1,219 @@
+#include <sys/types.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <egg/runner/runner.hpp>
+
+
+namespace test
+{
+
+std::atomic<int> calls(0);
+
+struct counter : public egg::signal::handler
+{
+
+counter() noexcept
+  : egg::signal::handler(SIGUSR1)
+{
+}
+
+virtual ~counter() noexcept {}
+
+void process(int the_id) noexcept
+{}
+
+void process(
+	int         the_id,
+	siginfo_t*  the_info,
+	void*       the_context) noexcept
+{
+  ++calls;
+}
+
+};
+
+// Daemon reporting its signal delivery to the launcher
+struct daemon : public egg::process
+{
+
+daemon(
+    const std::string& argv0,
+    const int          the_report)
+  : egg::process(argv0),
+    report(the_report)
+{
+  enable(property::daemon);
+  keep(report);
+}
+
+void before()
+{
+}
+
+void between()
+{
+}
+
+void after()
+{
+}
+
+void run()
+{
+  egg::signal::controller& c = egg::signal::controller::instance();
+
+  // Take the lowest free numbers: a descriptor closed by the
+  // daemonisation would be reused here
+  int sink[2];
+  if (::pipe2(sink, O_NONBLOCK))
+    return;
+
+  // Still the controller descriptor, the signalfd first
+  const std::vector<int> fds(c.get_descriptors());
+
+  char link[64];
+  char path[64];
+  std::snprintf(path, sizeof(path), "/proc/self/fd/%d", fds.empty() ? -1 : fds.front());
+
+  const ssize_t size = ::readlink(path, link, sizeof(link) - 1);
+  link[size > 0 ? size : 0] = '\0';
+
+  ::kill(::getpid(), SIGUSR1);
+
+  // The dispatcher thread of the thread mode runs in the daemon too
+  const bool is_dispatched = (egg::signal::controller::mode::thread == c.get_mode());
+
+  for (int i = 0; i < 10 && !calls; ++i)
+  {
+    if (is_dispatched)
+      ::usleep(100000);
+    else
+      c.dispatch(100);
+  }
+
+  // Nothing written to a reused descriptor
+  char stray[16];
+  const ssize_t strays = ::read(sink[0], stray, sizeof(stray));
+
+  char line[160];
+  const int length = std::snprintf(
+        line,
+        sizeof(line),
+        "%s %d %zd\n",
+        link,
+        calls.load(),
+        (strays > 0 ? strays : 0));
+
+  if (0 > ::write(report, line, length))
+  {
+    // Launcher gone
+  }
+}
+
+int report;
+
+};
+
+}
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::endl;
+  using std::cerr;
+  using mode = egg::signal::controller::mode;
+
+  int result = 0;
+
+  egg::signal::controller& c = egg::signal::controller::instance();
+
+  cout << "Checking deferred signal modes in the daemon" << endl;
+  cout << "---------------------------------------------------------" << endl;
+  try
+  {
+    for (const mode m : { mode::queue, mode::descriptor, mode::thread })
+    {
+      const char* name = (mode::queue      == m ? "queue" :
+                          mode::descriptor == m ? "descriptor" : "thread");
+
+      const char* expected = (mode::queue == m
+          ? "anon_inode:[eventfd]"
+          : "anon_inode:[signalfd]");
+
+      c.set_mode(m);
+      c.enable(new test::counter());
+
+      int report[2];
+      if (::pipe(report))
+        throw std::system_error(errno, std::system_category(), "pipe()");
+
+      {
+        const pid_t launcher = ::getpid();
+
+        test::daemon the_daemon(argv[0], report[1]);
+        the_daemon.execute();
+
+        // The daemon is done
+        if (::getpid() != launcher)
+          ::_exit(0);
+      }
+
+      ::close(report[1]);
+
+      // The daemon writes one line and exits
+      std::string line;
+      struct pollfd p = { report[0], POLLIN, 0 };
+      char buffer[160];
+
+      while (::poll(&p, 1, 5000) > 0)
+      {
+        const ssize_t count = ::read(report[0], buffer, sizeof(buffer));
+        if (count <= 0)
+          break;
+
+        line.append(buffer, count);
+      }
+
+      ::close(report[0]);
+
+      char link[64] = "";
+      int  calls    = 0;
+      long strays   = -1;
+      std::sscanf(line.c_str(), "%63s %d %ld", link, &calls, &strays);
+
+      cout << name << ": "
+           << link << ", " << calls << " calls, "
+           << strays << " stray bytes" << endl;
+
+      if (std::strcmp(link, expected) || calls != 1 || strays != 0)
+        result = 1;
+
+      c.disable(SIGUSR1);
+    }
+
+    c.set_mode(mode::action);
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+    result = 1;
+  }
+
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return result;
+}
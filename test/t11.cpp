@@ -0,0 +1,138 @@
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <egg/runner/runner.hpp>
+
+
+namespace test
+{
+
+// Stage variable, set once the first image upgrades
+const char* const stage_variable = "EGG_T11_STAGE";
+
+// Handed over state: line breaks included
+const char* const state = "first line\nsecond line";
+
+int result = 1;
+
+// Upgrades once, then checks what the new image got
+struct daemon : public egg::process
+{
+
+daemon(
+    const std::string& argv0)
+  : egg::process(argv0)
+{
+}
+
+void before()
+{
+}
+
+void between()
+{
+}
+
+void after()
+{
+}
+
+std::string save_state()
+{
+  return std::string(state);
+}
+
+void restore_state(const std::string& the_state)
+{
+  restored = the_state;
+}
+
+void run()
+{
+  using std::cout;
+  using std::endl;
+
+  if (!is_resumed())
+  {
+    ::setenv(test::stage_variable, "upgraded", 1);
+    upgrade();
+  }
+
+  const std::vector<int>&         fds   = get_listen_fds();
+  const std::vector<std::string>& names = get_listen_fd_names();
+
+  for (std::size_t i = 0; i < fds.size() && i < names.size(); ++i)
+    cout << "Descriptor:  " << fds[i] << " \"" << names[i] << "\"" << endl;
+
+  cout << "\"web\":       " << get_listen_fd("web") << endl
+       << "\"admin api\": " << get_listen_fd("admin api") << endl
+       << "State:       " << restored.size() << " bytes" << endl;
+
+  const std::vector<int>         expected_fds   = { 3, 4, 5 };
+  const std::vector<std::string> expected_names = { "web", "web", "admin api" };
+
+  result = (fds == expected_fds &&
+            names == expected_names &&
+            3 == get_listen_fd("web") &&
+            5 == get_listen_fd("admin api") &&
+            restored == state) ? 0 : 1;
+}
+
+std::string restored;
+
+};
+
+}
+
+int
+main(
+  const int   argc,
+  const char* argv[])
+{
+  using std::cout;
+  using std::endl;
+  using std::cerr;
+
+  if (!::getenv(test::stage_variable))
+  {
+    cout << "Checking the hot upgrade handover" << endl;
+    cout << "---------------------------------------------------------" << endl;
+
+    // Three activated descriptors, two sharing a name
+    for (int fd = egg::process::listen_fds_start; fd < egg::process::listen_fds_start + 3; ++fd)
+    {
+      const int opened = ::open("/dev/null", O_RDONLY);
+      if (opened != fd)
+      {
+        ::dup2(opened, fd);
+        ::close(opened);
+      }
+    }
+
+    ::setenv("LISTEN_PID", std::to_string(::getpid()).c_str(), 1);
+    ::setenv("LISTEN_FDS", "3", 1);
+    ::setenv("LISTEN_FDNAMES", "web:web:admin api", 1);
+  }
+
+  try
+  {
+    test::daemon the_daemon(argv[0]);
+    the_daemon.execute();
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+    test::result = 1;
+  }
+
+  cout  << "---------------------------------------------------------" << endl
+        << "Done." << endl << endl;
+
+  return test::result;
+}